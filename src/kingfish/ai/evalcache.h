@@ -0,0 +1,44 @@
+#ifndef KINGFISH_EVALCACHE_H
+#define KINGFISH_EVALCACHE_H
+
+#include <algorithm>
+
+#include "../types.h"
+
+const int EVAL_CACHE_SIZE = 1 << 14; // entries, 128KB per thread
+
+// The static evals of the positions a search thread evaluated last, by
+// zobrist key, for the transpositions and re-searches the hash table no
+// longer has an entry for. Each thread has its own, so no locks are needed.
+struct EvalCache {
+    struct Entry {
+        ui32 key32; // the high half of the key, the low half is the index
+        i32  eval;
+    };
+
+    Entry entries[EVAL_CACHE_SIZE];
+    ui64  probes = 0; // of this search, for the hit rate
+    ui64  hits   = 0;
+
+    inline void clear() {
+        std::fill(this->entries, this->entries + EVAL_CACHE_SIZE, Entry{});
+    }
+
+    inline bool probe(ui64 key, int &eval) {
+        const Entry &entry = this->entries[key & (EVAL_CACHE_SIZE - 1)];
+
+        this->probes++;
+        if (entry.key32 != ui32(key >> 32)) {
+            return false;
+        }
+        this->hits++;
+        eval = entry.eval;
+        return true;
+    }
+
+    inline void store(ui64 key, int eval) {
+        this->entries[key & (EVAL_CACHE_SIZE - 1)] = {ui32(key >> 32), eval};
+    }
+};
+
+#endif // !KINGFISH_EVALCACHE_H
@@ -0,0 +1,45 @@
+#ifndef KINGFISH_HISTORY_H
+#define KINGFISH_HISTORY_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "../move.h"
+#include "../types.h"
+
+const int HISTORY_MAX   = 16384; // scores stay within +-HISTORY_MAX
+const int HISTORY_BONUS = 1600;  // the most a single cutoff adds
+
+// What the quiet moves of earlier searches did, kept by each search thread
+// and used to order the quiet moves of the next ones. Small enough (24KB)
+// to stay in the cache of the core running the thread.
+struct MoveHistory {
+    i16  butterfly[CL_COUNT][SQ_COUNT][SQ_COUNT]; // by side, from and to
+    Move countermoves[SQ_COUNT][SQ_COUNT]; // the reply to a move's from, to
+
+    inline void clear() {
+        std::memset(this->butterfly, 0, sizeof(this->butterfly));
+        std::fill(&this->countermoves[0][0],
+                  &this->countermoves[0][0] + SQ_COUNT * SQ_COUNT,
+                  NULLMOVE);
+    }
+
+    inline int score(Color side, const Move &move) const {
+        return this->butterfly[side][move.from()][move.to()];
+    }
+
+    inline void update(Color side, const Move &move, int bonus) {
+        // gravity: the closer a score is to the limit, the less it moves
+        // towards it, so old successes fade as new ones come in
+        i16 &entry = this->butterfly[side][move.from()][move.to()];
+        bonus      = std::clamp(bonus, -HISTORY_BONUS, HISTORY_BONUS);
+        entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+    }
+
+    inline Move counterMove(const Move &previous) const {
+        return this->countermoves[previous.from()][previous.to()];
+    }
+};
+
+#endif // !KINGFISH_HISTORY_H
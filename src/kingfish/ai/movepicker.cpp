@@ -0,0 +1,159 @@
+#include "movepicker.h"
+
+#include "../bitboard.h"
+
+MovePicker::MovePicker(const Position    &_pos,
+                       const Move        &_tt_move,
+                       const Move        *_killers,
+                       const MoveHistory *_history,
+                       const Move        &_countermove)
+    : pos(_pos)
+    , history(_history)
+    , tt_move(_tt_move) {
+    for (int k = 0; k < KILLER_SLOTS; k++) {
+        this->killers[k] = _killers ? _killers[k] : NULLMOVE;
+    }
+    this->killers[KILLER_SLOTS] = _countermove;
+
+    if (this->tt_move != NULLMOVE && this->pos.isLegal(this->tt_move)) {
+        this->stage = PS_TT_MOVE;
+    } else {
+        this->tt_move = NULLMOVE;
+        this->stage   = PS_GEN_CAPTURES;
+    }
+}
+
+MovePicker::MovePicker(const Position &_pos,
+                       const Move     &_tt_move,
+                       bool            _captures_only)
+    : MovePicker(_pos,
+                 _captures_only && !_pos.isCapture(_tt_move) &&
+                         _tt_move.promotion() != PT_QUEEN
+                     ? NULLMOVE
+                     : _tt_move) {
+    this->captures_only = _captures_only;
+}
+
+bool MovePicker::pickBest(Move &move) {
+    // selection sort, one step per call, so that moves after a cutoff are
+    // never sorted
+    if (this->current >= this->moves.size()) {
+        return false;
+    }
+
+    int best = this->current;
+    for (int k = this->current + 1; k < this->moves.size(); k++) {
+        if (this->moves.score(k) > this->moves.score(best)) {
+            best = k;
+        }
+    }
+    this->moves.swap(this->current, best);
+
+    move = this->moves[this->current++];
+    return true;
+}
+
+bool MovePicker::next(Move &move) {
+    switch (this->stage) {
+        case PS_TT_MOVE:
+            this->stage++;
+            move = this->tt_move;
+            return true;
+
+        case PS_GEN_CAPTURES:
+            // MVV-LVA, the most valuable victim by the least valuable piece
+            generateMoves(this->pos, GEN_CAPTURES, this->moves);
+            for (int k = 0; k < this->moves.size(); k++) {
+                const Move &m      = this->moves[k];
+                PieceType   victim = this->pos.board[m.to()].getType();
+                if (victim == PT_NONE && this->pos.isCapture(m)) {
+                    victim = PT_PAWN; // en passant
+                }
+
+                int score = SEE_VALUES[victim];
+                if (m.promotion() == PT_QUEEN) {
+                    score += SEE_VALUES[PT_QUEEN];
+                }
+                this->moves.score(k) =
+                    score * 8 - this->pos.board[m.from()].getType();
+            }
+            this->stage++;
+            [[fallthrough]];
+
+        case PS_GOOD_CAPTURES:
+            while (this->pickBest(move)) {
+                if (move == this->tt_move) {
+                    continue;
+                }
+                if (!this->pos.seeGe(move, 0)) {
+                    this->bad_captures.push_back(move);
+                    continue;
+                }
+                return true;
+            }
+            if (this->captures_only) {
+                this->stage = PS_DONE;
+                return false;
+            }
+            this->stage++;
+            [[fallthrough]];
+
+        case PS_KILLERS:
+            while (this->killer_index <= KILLER_SLOTS) {
+                move = this->killers[this->killer_index++];
+
+                bool seen = move == this->tt_move;
+                for (int k = 0; k < this->killer_index - 1; k++) {
+                    seen |= move == this->killers[k];
+                }
+                if (move != NULLMOVE && !seen &&
+                    move.promotion() != PT_QUEEN &&
+                    !this->pos.isCapture(move) && this->pos.isLegal(move)) {
+                    return true;
+                }
+            }
+            this->stage++;
+            [[fallthrough]];
+
+        case PS_GEN_QUIETS:
+            this->moves.clear();
+            this->current = 0;
+            generateMoves(this->pos, GEN_QUIETS, this->moves);
+            for (int k = 0; k < this->moves.size(); k++) {
+                // by history, the pst gain only breaks ties and orders the
+                // moves the history knows nothing about yet
+                const Move &m     = this->moves[k];
+                int         score = this->pos.value(m);
+                if (this->history) {
+                    score += this->history->score(this->pos.turn, m);
+                }
+                this->moves.score(k) = score;
+            }
+            this->stage++;
+            [[fallthrough]];
+
+        case PS_QUIETS:
+            while (this->pickBest(move)) {
+                bool seen = move == this->tt_move;
+                for (int k = 0; k <= KILLER_SLOTS; k++) {
+                    seen |= move == this->killers[k];
+                }
+                if (!seen) {
+                    return true;
+                }
+            }
+            this->stage++;
+            this->current = 0;
+            [[fallthrough]];
+
+        case PS_BAD_CAPTURES:
+            if (this->current < this->bad_captures.size()) {
+                move = this->bad_captures[this->current++];
+                return true;
+            }
+            this->stage++;
+            [[fallthrough]];
+
+        default: return false;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef KINGFISH_MOVEPICKER_H
+#define KINGFISH_MOVEPICKER_H
+
+#include "../move.h"
+#include "../movegen.h"
+#include "../position.h"
+#include "history.h"
+
+const int KILLER_SLOTS = 2;
+
+typedef i8 PickerStage;
+
+enum PickerStages {
+
+    PS_TT_MOVE,
+    PS_GEN_CAPTURES,
+    PS_GOOD_CAPTURES,
+    PS_KILLERS, // then the countermove
+    PS_GEN_QUIETS,
+    PS_QUIETS,
+    PS_BAD_CAPTURES,
+    PS_DONE
+
+};
+
+// Hands out the legal moves of a position one at a time, best guesses
+// first. Every stage is only generated once the previous one has run dry,
+// so a cutoff on the transposition table move costs no generation at all.
+class MovePicker {
+  public:
+    MovePicker(const Position    &pos,
+               const Move        &tt_move,
+               const Move        *killers     = nullptr,
+               const MoveHistory *history     = nullptr,
+               const Move        &countermove = NULLMOVE);
+    // captures and queen promotions only, for the quiescence search
+    MovePicker(const Position &pos, const Move &tt_move, bool captures_only);
+
+    bool next(Move &move);
+
+    PickerStage stage;
+
+  private:
+    bool pickBest(Move &move);
+
+    const Position &pos;
+
+    const MoveHistory *history;
+    bool               captures_only = false;
+
+    Move tt_move;
+    Move killers[KILLER_SLOTS + 1]; // the last one is the countermove
+    int  killer_index = 0;
+
+    MoveList moves;
+    MoveList bad_captures;
+    int      current = 0;
+};
+
+#endif // !KINGFISH_MOVEPICKER_H
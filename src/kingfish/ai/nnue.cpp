@@ -0,0 +1,324 @@
+#include "nnue.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "../bits.h"
+#include "../consts.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KINGFISH_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define FORCE_INLINE __attribute__((always_inline)) inline
+#else
+#define FORCE_INLINE inline
+#endif
+
+// the kernels: acc = src + adds - subs over one accumulator side, and the
+// output layer's dot product of both clipped sides with its weights
+typedef void (*DeltaKernel)(const i16        *src,
+                            i16              *dst,
+                            const i16 *const *adds,
+                            int               add_count,
+                            const i16 *const *subs,
+                            int               sub_count);
+typedef i32 (*OutputKernel)(const i16 *us, const i16 *them, const i16 *weights);
+
+// plain loops, the target attributes of the callers below decide what the
+// compiler vectorises them into. The accumulator kernels are only these
+// loops auto-vectorised, the output layer's are written with intrinsics
+static FORCE_INLINE void deltaLoops(const i16        *src,
+                                    i16              *dst,
+                                    const i16 *const *adds,
+                                    int               add_count,
+                                    const i16 *const *subs,
+                                    int               sub_count) {
+    if (dst != src) {
+        std::memcpy(dst, src, NNUE_HIDDEN * sizeof(i16));
+    }
+    for (int a = 0; a < add_count; a++) {
+        for (int k = 0; k < NNUE_HIDDEN; k++) {
+            dst[k] += adds[a][k];
+        }
+    }
+    for (int s = 0; s < sub_count; s++) {
+        for (int k = 0; k < NNUE_HIDDEN; k++) {
+            dst[k] -= subs[s][k];
+        }
+    }
+}
+
+static void deltaScalar(const i16        *src,
+                        i16              *dst,
+                        const i16 *const *adds,
+                        int               add_count,
+                        const i16 *const *subs,
+                        int               sub_count) {
+    deltaLoops(src, dst, adds, add_count, subs, sub_count);
+}
+
+static i32 outputScalar(const i16 *us, const i16 *them, const i16 *weights) {
+    i32 sum = 0;
+    for (int k = 0; k < NNUE_HIDDEN; k++) {
+        sum += std::clamp<i32>(us[k], 0, NNUE_QA) * weights[k];
+        sum += std::clamp<i32>(them[k], 0, NNUE_QA) *
+               weights[NNUE_HIDDEN + k];
+    }
+    return sum;
+}
+
+#ifdef KINGFISH_X86_KERNELS
+__attribute__((target("sse4.1"))) static void
+deltaSse41(const i16        *src,
+           i16              *dst,
+           const i16 *const *adds,
+           int               add_count,
+           const i16 *const *subs,
+           int               sub_count) {
+    deltaLoops(src, dst, adds, add_count, subs, sub_count);
+}
+
+__attribute__((target("sse4.1"))) static i32
+outputSse41(const i16 *us, const i16 *them, const i16 *weights) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa   = _mm_set1_epi16(NNUE_QA);
+
+    __m128i sum = zero;
+    for (int side = 0; side < CL_COUNT; side++) {
+        const i16 *acc = side == 0 ? us : them;
+        const i16 *w   = weights + side * NNUE_HIDDEN;
+        for (int k = 0; k < NNUE_HIDDEN; k += 8) {
+            __m128i v  = _mm_load_si128((const __m128i *)(acc + k));
+            __m128i wv = _mm_loadu_si128((const __m128i *)(w + k));
+            v          = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+            sum        = _mm_add_epi32(sum, _mm_madd_epi16(v, wv));
+        }
+    }
+
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2"))) static void
+deltaAvx2(const i16        *src,
+          i16              *dst,
+          const i16 *const *adds,
+          int               add_count,
+          const i16 *const *subs,
+          int               sub_count) {
+    deltaLoops(src, dst, adds, add_count, subs, sub_count);
+}
+
+__attribute__((target("avx2"))) static i32
+outputAvx2(const i16 *us, const i16 *them, const i16 *weights) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa   = _mm256_set1_epi16(NNUE_QA);
+
+    __m256i sum = zero;
+    for (int side = 0; side < CL_COUNT; side++) {
+        const i16 *acc = side == 0 ? us : them;
+        const i16 *w   = weights + side * NNUE_HIDDEN;
+        for (int k = 0; k < NNUE_HIDDEN; k += 16) {
+            __m256i v  = _mm256_load_si256((const __m256i *)(acc + k));
+            __m256i wv = _mm256_loadu_si256((const __m256i *)(w + k));
+            v          = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+            sum        = _mm256_add_epi32(sum, _mm256_madd_epi16(v, wv));
+        }
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+struct Kernels {
+    const char  *name;
+    DeltaKernel  delta;
+    OutputKernel output;
+};
+
+static Kernels pickKernels() {
+#ifdef KINGFISH_X86_KERNELS
+    __builtin_cpu_init(); // may run before the other static constructors
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", deltaAvx2, outputAvx2};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return {"sse4.1", deltaSse41, outputSse41};
+    }
+#endif
+    return {"scalar", deltaScalar, outputScalar};
+}
+
+static const Kernels KERNELS = pickKernels();
+
+const char *simdName() {
+    return KERNELS.name;
+}
+
+const i16 *Network::column(Color  side,
+                           Square king,
+                           Piece  piece,
+                           Square sq) const {
+    // the feature of a piece for one side, everything mirrored so that
+    // each side sees the board from its own end
+    Square flip    = side == CL_WHITE ? 0 : 56;
+    int    rel     = (piece.getColor() != side) * 6 + piece.getType();
+    int    feature = ((king ^ flip) * 12 + rel) * SQ_COUNT + (sq ^ flip);
+
+    return &this->feature_weights[std::size_t(feature) * NNUE_HIDDEN];
+}
+
+bool Network::load(const std::string &_path) {
+    // the weights are read as they are stored, so little-endian hosts only
+    this->loaded = false;
+    this->path   = _path;
+
+    std::ifstream file(_path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    char magic[4];
+    ui32 header[3];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file || std::memcmp(magic, "KFNN", 4) != 0 ||
+        header[0] != NNUE_VERSION || header[1] != NNUE_HIDDEN ||
+        header[2] != NNUE_FEATURES) {
+        return false;
+    }
+
+    this->feature_weights.resize(std::size_t(NNUE_FEATURES) * NNUE_HIDDEN);
+    this->feature_biases.resize(NNUE_HIDDEN);
+    this->output_weights.resize(2 * NNUE_HIDDEN);
+
+    auto readAll = [&file](std::vector<i16> &values) {
+        file.read(reinterpret_cast<char *>(values.data()),
+                  std::streamsize(values.size() * sizeof(i16)));
+    };
+    readAll(this->feature_weights);
+    readAll(this->feature_biases);
+    readAll(this->output_weights);
+    file.read(reinterpret_cast<char *>(&this->output_bias),
+              sizeof(this->output_bias));
+
+    // a file too short or too long is not this network
+    if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+
+    this->loaded = true;
+    return true;
+}
+
+void Network::refreshSide(const Position &pos,
+                          Color           side,
+                          Accumulator    &acc) const {
+    Square     king = pos.kingSquare(side);
+    i16       *dst  = acc.values[side];
+    const i16 *src  = this->feature_biases.data();
+
+    // up to 32 pieces, added two columns at a time
+    const i16 *columns[2];
+    int        count = 0;
+    for (Bitboard occ = pos.occupied(); occ;) {
+        Square sq        = bits::popLsb(occ);
+        columns[count++] = this->column(side, king, pos.board[sq], sq);
+        if (count == 2 || !occ) {
+            KERNELS.delta(src, dst, columns, count, nullptr, 0);
+            src   = dst;
+            count = 0;
+        }
+    }
+}
+
+void Network::refresh(const Position &pos, Accumulator &acc) const {
+    this->refreshSide(pos, CL_WHITE, acc);
+    this->refreshSide(pos, CL_BLACK, acc);
+}
+
+void Network::update(const Position    &pos,
+                     const Status      &status,
+                     const Accumulator &parent,
+                     Accumulator       &acc) const {
+    const Move &move = status.last_move;
+    if (move == NULLMOVE) {
+        acc = parent;
+        return;
+    }
+
+    Color  us = getOppositeColor(pos.turn), them = pos.turn;
+    Square from = move.from(), to = move.to();
+    Piece  placed = pos.board[to];
+    Piece  moved  = move.isPromotion() ? Piece(us, PT_PAWN) : placed;
+
+    // at most two pieces arrive on a square and two leave one
+    Piece  added[2], removed[2];
+    Square added_sq[2], removed_sq[2];
+    int    add_count = 0, sub_count = 0;
+
+    added[add_count]        = placed;
+    added_sq[add_count++]   = to;
+    removed[sub_count]      = moved;
+    removed_sq[sub_count++] = from;
+
+    if (status.captured != PIECE_NONE) {
+        removed[sub_count]      = status.captured;
+        removed_sq[sub_count++] = to;
+    } else if (moved.getType() == PT_PAWN && to == status.ep) {
+        removed[sub_count]      = Piece(them, PT_PAWN);
+        removed_sq[sub_count++] = to + (us == CL_WHITE ? 8 : -8);
+    }
+
+    if (moved.getType() == PT_KING && std::abs(to - from) == 2) {
+        added[add_count]        = Piece(us, PT_ROOK);
+        added_sq[add_count++]   = (from + to) / 2;
+        removed[sub_count]      = Piece(us, PT_ROOK);
+        removed_sq[sub_count++] = to > from ? to + 1 : to - 2;
+    }
+
+    for (Color side : {CL_WHITE, CL_BLACK}) {
+        // a king move changes every feature of its own side
+        if (moved.getType() == PT_KING && side == us) {
+            this->refreshSide(pos, side, acc);
+            continue;
+        }
+
+        Square     king = pos.kingSquare(side);
+        const i16 *adds[2], *subs[2];
+        for (int k = 0; k < add_count; k++) {
+            adds[k] = this->column(side, king, added[k], added_sq[k]);
+        }
+        for (int k = 0; k < sub_count; k++) {
+            subs[k] = this->column(side, king, removed[k], removed_sq[k]);
+        }
+
+        KERNELS.delta(parent.values[side],
+                      acc.values[side],
+                      adds,
+                      add_count,
+                      subs,
+                      sub_count);
+    }
+}
+
+int Network::evaluate(const Position &pos, const Accumulator &acc) const {
+    i32 sum = KERNELS.output(acc.values[pos.turn],
+                             acc.values[getOppositeColor(pos.turn)],
+                             this->output_weights.data()) +
+              this->output_bias;
+
+    // never as large as a mate score
+    i64 score = i64(sum) * NNUE_SCALE / (NNUE_QA * NNUE_QB);
+    return int(std::clamp<i64>(score, 1 - MATE_LOWER, MATE_LOWER - 1));
+}
@@ -0,0 +1,76 @@
+#ifndef KINGFISH_NNUE_H
+#define KINGFISH_NNUE_H
+
+#include <string>
+#include <vector>
+
+#include "../position.h"
+#include "../types.h"
+
+// An efficiently updatable network: king-relative piece-square features
+// (HalfKA, every piece of both sides seen from each king) feed one int16
+// accumulator per side, which a move only changes in a few columns. The
+// side to move's accumulator and the other one, clipped to [0, NNUE_QA],
+// go through one affine layer to the score.
+//
+// The file is little-endian:
+//   char  magic[4]                          "KFNN"
+//   ui32  version, hidden size, features    NNUE_VERSION, NNUE_HIDDEN,
+//                                           NNUE_FEATURES
+//   i16   feature weights[NNUE_FEATURES][NNUE_HIDDEN]
+//   i16   feature biases[NNUE_HIDDEN]
+//   i16   output weights[2 * NNUE_HIDDEN]   side to move first
+//   i32   output bias
+//
+// No trained network ships with the engine, without one it falls back to
+// the psqt eval. kingfish_nnue writes random ones in this format to test
+// the incremental updates with.
+const ui32 NNUE_VERSION  = 1;
+const int  NNUE_HIDDEN   = 256;
+const int  NNUE_FEATURES = SQ_COUNT * 2 * 6 * SQ_COUNT; // king, piece, square
+
+const int NNUE_QA    = 255; // accumulator quantisation
+const int NNUE_QB    = 64;  // output weight quantisation
+const int NNUE_SCALE = 400; // centipawns per unit of the output
+
+struct alignas(64) Accumulator {
+    i16 values[CL_COUNT][NNUE_HIDDEN]; // by perspective
+};
+
+class Network {
+  public:
+    bool load(const std::string &path);
+
+    inline bool               isLoaded() const { return this->loaded; }
+    inline const std::string &getPath() const { return this->path; }
+
+    // the accumulator of a position from scratch
+    void refresh(const Position &pos, Accumulator &acc) const;
+
+    // the accumulator of pos from the one of the position before, pos being
+    // the result of the move, or null move, status was made with
+    void update(const Position    &pos,
+                const Status      &status,
+                const Accumulator &parent,
+                Accumulator       &acc) const;
+
+    // the score for the side to move
+    int evaluate(const Position &pos, const Accumulator &acc) const;
+
+  private:
+    void refreshSide(const Position &pos, Color side, Accumulator &acc) const;
+    const i16 *column(Color side, Square king, Piece piece, Square sq) const;
+
+    bool        loaded = false;
+    std::string path;
+
+    std::vector<i16> feature_weights;
+    std::vector<i16> feature_biases;
+    std::vector<i16> output_weights;
+    i32              output_bias = 0;
+};
+
+// which of the scalar, sse4.1 and avx2 kernels the cpu runs, picked once
+const char *simdName();
+
+#endif // !KINGFISH_NNUE_H
@@ -0,0 +1,138 @@
+#include "pawns.h"
+
+#include <algorithm>
+
+#include "../bitboard.h"
+#include "../bits.h"
+#include "../pieces.h"
+
+// by the pawn's rank as its own side sees it, RANK_1 to RANK_8
+constexpr int PASSED_MG[RANK_COUNT]      = {0, 5, 10, 15, 30, 50, 80, 0};
+constexpr int PASSED_EG[RANK_COUNT]      = {0, 10, 15, 30, 50, 80, 120, 0};
+constexpr int PASSED_FREE_EG[RANK_COUNT] = {0, 0, 5, 10, 15, 25, 40, 0};
+
+constexpr int DOUBLED_MG  = 10, DOUBLED_EG = 20;
+constexpr int ISOLATED_MG = 10, ISOLATED_EG = 15;
+constexpr int BACKWARD_MG = 8, BACKWARD_EG = 12;
+
+constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+
+static inline Bitboard fileBB(int file) {
+    return FILE_A_BB << file;
+}
+
+static inline Bitboard adjacentFilesBB(int file) {
+    return (file > FL_A ? fileBB(file - 1) : 0) |
+           (file < FL_H ? fileBB(file + 1) : 0);
+}
+
+// the ranks in front of the square as the side sees it, white's being the
+// lower squares since a8 is square 0
+static inline Bitboard forwardRanksBB(Color side, Square square) {
+    int row = square / 8;
+    if (side == CL_WHITE) {
+        return (1ULL << (8 * row)) - 1;
+    }
+    return row == 7 ? 0 : ~0ULL << (8 * (row + 1));
+}
+
+static inline int relativeRank(Color side, Square square) {
+    return side == CL_WHITE ? getRank(square) : RANK_8 - getRank(square);
+}
+
+static inline Square stopSquare(Color side, Square square) {
+    return side == CL_WHITE ? square - 8 : square + 8;
+}
+
+static void evaluatePawns(const Position &pos, PawnEntry &entry) {
+    entry.mg = entry.eg = 0;
+    for (Color side : {CL_WHITE, CL_BLACK}) {
+        entry.passed[side]  = 0;
+        entry.attacks[side] = 0;
+        for (Bitboard pawns = pos.pieces(side, PT_PAWN); pawns;) {
+            Square square = bits::popLsb(pawns);
+            entry.attacks[side] |= BBS::pawnAttacks(side, square);
+        }
+    }
+
+    for (Color side : {CL_WHITE, CL_BLACK}) {
+        Color    them  = getOppositeColor(side);
+        Bitboard ours  = pos.pieces(side, PT_PAWN);
+        Bitboard their = pos.pieces(them, PT_PAWN);
+        int      sign  = side == CL_WHITE ? 1 : -1;
+        int      mg = 0, eg = 0;
+
+        for (Bitboard pawns = ours; pawns;) {
+            Square   square   = bits::popLsb(pawns);
+            int      file     = getFile(square);
+            Bitboard forward  = forwardRanksBB(side, square);
+            Bitboard adjacent = adjacentFilesBB(file);
+
+            // only the front pawn of a doubled pair can be passed
+            bool doubled  = ours & forward & fileBB(file);
+            bool isolated = !(ours & adjacent);
+            bool passed   = !doubled &&
+                          !(their & forward & (adjacent | fileBB(file)));
+
+            // no pawn beside or behind it to support its advance, and the
+            // square in front is held by an enemy pawn
+            bool backward =
+                !isolated && !(ours & adjacent & ~forward) &&
+                get_bit(entry.attacks[them], stopSquare(side, square));
+
+            if (doubled) {
+                mg -= DOUBLED_MG, eg -= DOUBLED_EG;
+            }
+            if (isolated) {
+                mg -= ISOLATED_MG, eg -= ISOLATED_EG;
+            } else if (backward) {
+                mg -= BACKWARD_MG, eg -= BACKWARD_EG;
+            }
+            if (passed) {
+                set_bit(entry.passed[side], square);
+                mg += PASSED_MG[relativeRank(side, square)];
+                eg += PASSED_EG[relativeRank(side, square)];
+            }
+        }
+
+        entry.mg += sign * mg;
+        entry.eg += sign * eg;
+    }
+}
+
+const PawnEntry &PawnTable::probe(const Position &pos) {
+    PawnEntry &entry = this->entries[pos.pawn_key & (PAWN_TABLE_SIZE - 1)];
+
+    this->probes++;
+    if (entry.key == pos.pawn_key) {
+        this->hits++;
+        return entry;
+    }
+
+    evaluatePawns(pos, entry);
+    entry.key = pos.pawn_key;
+    return entry;
+}
+
+int PawnTable::evaluate(const Position &pos) {
+    const PawnEntry &entry = this->probe(pos);
+
+    int mg = entry.mg, eg = entry.eg;
+
+    // what depends on the other pieces is not kept: a passed pawn whose
+    // way forward is free is worth more than a blocked one
+    Bitboard occupied = pos.occupied();
+    for (Color side : {CL_WHITE, CL_BLACK}) {
+        int sign = side == CL_WHITE ? 1 : -1;
+        for (Bitboard passed = entry.passed[side]; passed;) {
+            Square square = bits::popLsb(passed);
+            if (!get_bit(occupied, stopSquare(side, square))) {
+                eg += sign * PASSED_FREE_EG[relativeRank(side, square)];
+            }
+        }
+    }
+
+    int phase = std::min<int>(pos.phase, PHASE_MAX);
+    int score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+    return pos.turn == CL_WHITE ? score : -score;
+}
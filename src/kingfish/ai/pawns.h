@@ -0,0 +1,38 @@
+#ifndef KINGFISH_PAWNS_H
+#define KINGFISH_PAWNS_H
+
+#include <vector>
+
+#include "../position.h"
+#include "../types.h"
+
+const int PAWN_TABLE_SIZE = 1 << 13; // entries, 384KB per thread
+
+struct PawnEntry { // what the pawns alone say, by Position::pawn_key
+    ui64     key = 0; // no pawns at all, whose terms are all 0
+    Bitboard passed[CL_COUNT]  = {};
+    Bitboard attacks[CL_COUNT] = {};
+    int      mg = 0, eg = 0; // white's terms minus black's
+};
+
+// The pawn structure changes far less often than the rest of the position,
+// so its terms (passed, isolated, doubled and backward pawns) are kept by
+// pawn key and only computed on a miss. Each search thread has its own.
+class PawnTable {
+  public:
+    PawnTable()
+        : entries(PAWN_TABLE_SIZE) {}
+
+    const PawnEntry &probe(const Position &pos);
+
+    // the pawn terms for the side to move, tapered like Position::eval
+    int evaluate(const Position &pos);
+
+    ui64 probes = 0; // of this search, for the hit rate
+    ui64 hits   = 0;
+
+  private:
+    std::vector<PawnEntry> entries;
+};
+
+#endif // !KINGFISH_PAWNS_H
@@ -1,16 +1,19 @@
 #include "searcher.h"
 
 #include <algorithm>
+#include <cassert>
 #include <chrono>
 #include <climits>
+#include <cmath>
 #include <coroutine>
+#include <cstring>
 #include <functional>
 #include <iostream>
-#include <map>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include "../bits.h"
 #include "../clock.h"
 #include "../consts.h"
 #include "../move.h"
@@ -18,139 +21,745 @@
 #include "../position.h"
 #include "../uci.h"
 #include "../utils/generator.h"
+#include "movepicker.h"
 
-int Searcher::bound(Position &pos, int gamma, int depth, bool can_null = true) {
-    this->nodes_searched += 1;
+// the quiet moves searched before a cutoff that lose history for it
+static constexpr int MAX_QUIETS = 64;
 
-    depth = std::max(depth, 0);
+void Searcher::setParams(const SearchParams &_params) {
+    this->params = _params;
 
-    if (pos.score <= -MATE_LOWER) {
-        return -MATE_UPPER;
+    // base + ln(depth) * ln(move number) / divisor, both in hundredths
+    double base    = this->params.lmr_base / 100.0;
+    double divisor = this->params.lmr_divisor / 100.0;
+    for (int d = 1; d < 64; d++) {
+        for (int m = 1; m < 64; m++) {
+            this->reductions[d][m] =
+                int(base + std::log(d) * std::log(m) / divisor);
+        }
+    }
+}
+
+void Searcher::setRoot(const std::vector<Position> &hist) {
+    this->root       = hist.back();
+    this->root_index = hist.size() - 1;
+
+    this->keys.resize(hist.size() + MAX_PLY);
+    for (std::size_t k = 0; k < hist.size(); k++) {
+        this->keys[k] = hist[k].key;
+    }
+
+    // killers are by ply, they mean nothing at the same ply of another
+    // root, and the accumulators may be of a network loaded since
+    for (SearchStack &ss : this->stack) {
+        std::fill(ss.killers, ss.killers + KILLER_SLOTS, NULLMOVE);
+        ss.acc_key = 0;
+    }
+}
+
+bool Searcher::isRepetition(const Position &pos, int ply) const {
+    // only positions since the last capture or pawn move can repeat, and
+    // only with the same side to move
+    int index = int(this->root_index) + ply;
+    int end   = std::max(0, index - pos.rule50);
+
+    for (int k = index - 4; k >= end; k -= 2) {
+        if (this->keys[k] == pos.key) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Searcher::isRootMove(const Move &move) const {
+    if (this->root_moves.empty()) {
+        return true;
+    }
+    return std::find(this->root_moves.begin(),
+                     this->root_moves.end(),
+                     move) != this->root_moves.end();
+}
+
+bool Searcher::probeTablebases(Position &pos,
+                               int       depth,
+                               int      &score,
+                               Bound    &bound) {
+    // only just after a capture or pawn move, where the 50 move rule can't
+    // have spoiled the result yet, and only with few enough pieces, with
+    // the most the tables have only deep enough to be worth the probe
+    int pieces = int(bits::popcount(pos.occupied()));
+    if (pieces > this->params.tb_cardinality ||
+        (pieces == this->params.tb_cardinality &&
+         depth < this->params.tb_probe_depth) ||
+        pos.rule50 != 0 || pos.castling_rights != CR_NONE) {
+        return false;
+    }
+
+    // with the side not to move in check the position isn't legal, the
+    // tables know nothing of it
+    Color them = getOppositeColor(pos.turn);
+    if (pos.isSquareAttacked(pos.kingSquare(them), pos.turn)) {
+        return false;
+    }
+
+    ProbeState result;
+    WDLScore   wdl = Tablebases::probeWDL(pos, result);
+    if (result == PROBE_FAIL) {
+        return false;
+    }
+    this->tb_hits.store(this->tb_hits.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+
+    // the cursed wins and blessed losses just off a draw when the 50 move
+    // rule counts, so the search still prefers them
+    int draw = this->params.tb_rule50 ? 1 : 0;
+    if (wdl < -draw) {
+        score = -TB_WIN;
+        bound = BOUND_UPPER;
+    } else if (wdl > draw) {
+        score = TB_WIN;
+        bound = BOUND_LOWER;
+    } else {
+        score = 2 * wdl * draw;
+        bound = BOUND_EXACT;
+    }
+    return true;
+}
+
+int Searcher::evaluate(const Position &pos, int ply) {
+    // a position with a king taken is scored by the psqt eval alone, as a
+    // mate, the network can't evaluate it
+    int psqt = pos.eval();
+    if (psqt <= -MATE_LOWER) {
+        return psqt;
+    }
+
+    int eval;
+    if (this->eval_cache.probe(pos.key, eval)) {
+        return eval;
+    }
+
+    // a known ending has an eval of its own, others may only be scaled
+    // down towards a draw
+    const MaterialEntry &material = this->material.probe(pos);
+    if (material.eval) {
+        eval = material.eval(pos, material.strong);
+        eval = material.strong == pos.turn ? eval : -eval;
+    } else {
+        if (this->use_nnue) {
+            this->updateAccumulator(pos, ply);
+            eval = this->network.evaluate(pos, this->stack[ply].acc);
+        } else {
+            eval = psqt + this->pawns.evaluate(pos);
+        }
+        Color favoured = eval > 0 ? pos.turn : getOppositeColor(pos.turn);
+        eval = eval * material.scale(pos, favoured) / SCALE_NORMAL;
+    }
+
+    this->eval_cache.store(pos.key, eval);
+    return eval;
+}
+
+void Searcher::updateAccumulator(const Position &pos, int ply) {
+    // a node only needs its accumulator to evaluate or to make a move, so
+    // one whose eval came from a cache may never compute it. The parent of
+    // a node has made a move, so its accumulator is always there
+    SearchStack &ss = this->stack[ply];
+    if (!this->use_nnue || ss.acc_key == pos.key) {
+        return;
+    }
+
+    if (ply == 0) {
+        this->network.refresh(pos, ss.acc);
+    } else {
+        const SearchStack &parent = this->stack[ply - 1];
+        this->network.update(pos, parent.status, parent.acc, ss.acc);
+    }
+    ss.acc_key = pos.key;
+
+#ifndef NDEBUG
+    Accumulator fresh;
+    this->network.refresh(pos, fresh);
+    assert(std::memcmp(&fresh, &ss.acc, sizeof(fresh)) == 0);
+#endif
+}
+
+Move Searcher::counterMove(int ply) const {
+    Move previous = ply > 0 ? this->stack[ply - 1].status.last_move : NULLMOVE;
+    return previous != NULLMOVE ? this->history.counterMove(previous)
+                                : NULLMOVE;
+}
+
+void Searcher::updateQuietStats(const Position &pos,
+                                int             ply,
+                                int             depth,
+                                const Move     &move,
+                                const Move     *quiets,
+                                int             quiet_count) {
+    // the quiet move that caused a cutoff becomes a killer for this ply and
+    // the countermove to the last move, and gains history the quiet moves
+    // tried before it lose
+    SearchStack &ss = this->stack[ply];
+    if (ss.killers[0] != move) {
+        std::copy_backward(ss.killers,
+                           ss.killers + KILLER_SLOTS - 1,
+                           ss.killers + KILLER_SLOTS);
+        ss.killers[0] = move;
+    }
+
+    if (ply > 0 && this->stack[ply - 1].status.last_move != NULLMOVE) {
+        const Move &previous = this->stack[ply - 1].status.last_move;
+        this->history.countermoves[previous.from()][previous.to()] = move;
+    }
+
+    int bonus = depth * depth;
+    this->history.update(pos.turn, move, bonus);
+    for (int k = 0; k < quiet_count; k++) {
+        if (quiets[k] != move) {
+            this->history.update(pos.turn, quiets[k], -bonus);
+        }
     }
+}
 
-    auto entry = this->tp_score.get(Key(pos.hash(), depth, can_null));
-    if (entry.lower >= gamma) {
-        return entry.lower;
+int Searcher::bound(
+    Position &pos, int gamma, int depth, int ply, bool can_null = true) {
+    if (depth <= 0) {
+        return this->qsearch(pos, gamma - 1, gamma, ply);
     }
-    if (entry.upper < gamma) {
-        return entry.upper;
+
+    this->nodes_searched.store(
+        this->nodes_searched.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+
+    // another thread or the uci loop ended the search, the result of this
+    // node is thrown away so it doesn't matter
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return 0;
     }
 
-    if (can_null && depth > 0 &&
-        std::find(this->history.begin(), this->history.end(), pos) !=
-            this->history.end()) {
+    if (ply >= MAX_PLY - 1) {
+        return pos.eval();
+    }
+    SearchStack &ss = this->stack[ply];
+
+    this->keys[this->root_index + ply] = pos.key;
+    if (ply > 0 && this->isRepetition(pos, ply)) {
         return 0;
     }
 
-    auto moves = [&]() -> Generator<std::pair<Move, int>> {
-        bool any_of_RBNQ = std::find(pos.board.begin(), pos.board.end(), 'R') !=
-                               pos.board.end() ||
-                           std::find(pos.board.begin(), pos.board.end(), 'B') !=
-                               pos.board.end() ||
-                           std::find(pos.board.begin(), pos.board.end(), 'N') !=
-                               pos.board.end() ||
-                           std::find(pos.board.begin(), pos.board.end(), 'Q') !=
-                               pos.board.end();
+    TTEntry entry;
+    bool    tt_hit = this->tt.probe(pos.key, entry);
+    if (tt_hit && entry.depth >= depth) {
+        if ((entry.bound() & BOUND_LOWER) && entry.score >= gamma) {
+            return entry.score;
+        }
+        if ((entry.bound() & BOUND_UPPER) && entry.score < gamma) {
+            return entry.score;
+        }
+    }
+
+    ss.static_eval = tt_hit ? entry.eval : this->evaluate(pos, ply);
+    if (ss.static_eval <= -MATE_LOWER) {
+        return -MATE_UPPER;
+    }
 
-        if (can_null && depth > NULLMOVE_DEPTH && any_of_RBNQ) {
-            Position rot_board = pos.rotate(true);
-            co_yield {NULLMOVE, -this->bound(rot_board, 1 - gamma, depth - 3)};
+    // the tables' result is kept deeper than any search would go, it won't
+    // change
+    int   tb_score;
+    Bound tb_bound;
+    if (ply > 0 && this->probeTablebases(pos, depth, tb_score, tb_bound)) {
+        if (tb_bound == BOUND_EXACT ||
+            (tb_bound == BOUND_LOWER ? tb_score >= gamma : tb_score < gamma)) {
+            this->tt.store(pos.key,
+                           std::min(MAX_PLY - 1, depth + 6),
+                           tb_score,
+                           tb_bound,
+                           NULLMOVE,
+                           ss.static_eval);
+            return tb_score;
         }
+    }
 
-        if (depth == 0) {
-            co_yield {NULLMOVE, pos.score};
+    int  best      = -MATE_UPPER;
+    Move best_move = NULLMOVE;
+
+    this->updateAccumulator(pos, ply);
+    if (can_null && depth > NULLMOVE_DEPTH && !pos.isCheck() &&
+        pos.hasNonPawnMaterial(pos.turn)) {
+        pos.makeNull(ss.status);
+        best = -this->bound(pos, 1 - gamma, depth - 3, ply + 1);
+        pos.unmakeNull(ss.status);
+    }
+
+    if (best < gamma) {
+        // without a hash move, find one with a shallower search
+        Move tt_move = tt_hit ? entry.move : NULLMOVE;
+        if (tt_move == NULLMOVE && depth > 2) {
+            this->bound(pos, gamma, depth - 3, ply, false);
+            if (this->tt.probe(pos.key, entry)) {
+                tt_move = entry.move;
+            }
         }
 
-        int val_lower = (depth == 0 ? QS : -MATE_LOWER);
+        Move quiets[MAX_QUIETS];
+        int  move_count = 0, quiet_count = 0;
+
+        MovePicker &picker = ss.picker.emplace(
+            pos, tt_move, ss.killers, &this->history, this->counterMove(ply));
+        for (Move move; picker.next(move);) {
+            if (ply == 0 && !this->isRootMove(move)) {
+                continue;
+            }
+            int  val   = pos.value(move);
+            bool quiet = !pos.isCapture(move) && !move.isPromotion();
+
+            int score;
+            if (depth <= 1 && ss.static_eval + val < gamma) {
+                // the moves are not sorted by val, so a futile move is only
+                // scored, the ones after it may still be worth a search
+                score = val < MATE_LOWER ? ss.static_eval + val : MATE_UPPER;
+            } else {
+                pos.makeMove(move, ss.status);
+                this->tt.prefetch(pos.key);
+                score = -this->bound(pos, 1 - gamma, depth - 1, ply + 1);
+                pos.unmakeMove(move, ss.status);
+            }
 
-        Move killer;
-        if (this->tp_move.find(pos.hash()) != this->tp_move.end()) {
-            if (depth > 2) {
-                this->bound(pos, gamma, depth - 3, false);
-                killer = tp_move.at(pos.hash());
+            move_count++;
 
-                if (pos.value(killer) >= val_lower) {
-                    Position moved = pos.move(killer);
-                    co_yield {killer,
-                              -this->bound(moved, 1 - gamma, depth - 1)};
+            best = std::max(best, score);
+            if (best >= gamma) {
+                best_move = move;
+                if (quiet) {
+                    this->updateQuietStats(
+                        pos, ply, depth, move, quiets, quiet_count);
                 }
+                this->cutoffs++;
+                this->first_move_cutoffs += move_count == 1;
+                break;
+            }
+
+            if (quiet && quiet_count < MAX_QUIETS) {
+                quiets[quiet_count++] = move;
+            }
+        }
+    }
+
+    if (best == -MATE_UPPER) {
+        best = pos.isCheck() ? -MATE_LOWER : 0;
+    }
+
+    // the children may have been cut short, don't keep their result
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return best;
+    }
+
+    if (ply == 0 && best_move != NULLMOVE) {
+        this->root_move = best_move;
+    }
+
+    this->tt.store(pos.key,
+                   depth,
+                   best,
+                   best >= gamma ? BOUND_LOWER : BOUND_UPPER,
+                   best_move,
+                   ss.static_eval);
+    return best;
+}
+
+int Searcher::pvs(Position &pos,
+                  int       alpha,
+                  int       beta,
+                  int       depth,
+                  int       ply,
+                  bool      can_null = true) {
+    if (depth <= 0) {
+        return this->qsearch(pos, alpha, beta, ply);
+    }
+
+    this->nodes_searched.store(
+        this->nodes_searched.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    bool pv_node = beta - alpha > 1;
+
+    SearchStack &ss = this->stack[ply];
+    ss.pv_length    = 0;
+
+    if (ply >= MAX_PLY - 1) {
+        return pos.eval();
+    }
+
+    this->keys[this->root_index + ply] = pos.key;
+    if (ply > 0 && this->isRepetition(pos, ply)) {
+        return 0;
+    }
+
+    // pv nodes take no cutoffs from the table, so the pv is never cut short
+    TTEntry entry;
+    bool    tt_hit = this->tt.probe(pos.key, entry);
+    if (!pv_node && tt_hit && entry.depth >= depth) {
+        if ((entry.bound() & BOUND_LOWER) && entry.score >= beta) {
+            return entry.score;
+        }
+        if ((entry.bound() & BOUND_UPPER) && entry.score <= alpha) {
+            return entry.score;
+        }
+    }
+
+    ss.static_eval = tt_hit ? entry.eval : this->evaluate(pos, ply);
+    if (ss.static_eval <= -MATE_LOWER) {
+        return -MATE_UPPER;
+    }
+
+    const SearchParams &params = this->params;
+
+    int  alpha_orig = alpha;
+    int  best       = -MATE_UPPER;
+    int  max_score  = MATE_UPPER; // what the tables say the node is worth
+    Move best_move  = NULLMOVE;
+    bool in_check   = pos.isCheck();
+
+    int   tb_score;
+    Bound tb_bound;
+    if (ply > 0 && this->probeTablebases(pos, depth, tb_score, tb_bound)) {
+        if (tb_bound == BOUND_EXACT ||
+            (tb_bound == BOUND_LOWER ? tb_score >= beta : tb_score <= alpha)) {
+            this->tt.store(pos.key,
+                           std::min(MAX_PLY - 1, depth + 6),
+                           tb_score,
+                           tb_bound,
+                           NULLMOVE,
+                           ss.static_eval);
+            return tb_score;
+        }
+
+        // a pv node still searches for the pv, within what the tables say
+        if (pv_node) {
+            if (tb_bound == BOUND_LOWER) {
+                best  = tb_score;
+                alpha = std::max(alpha, best);
+            } else {
+                max_score = tb_score;
             }
         }
+    }
 
-        std::vector<std::pair<int, Move>> rest_moves;
+    // reverse futility: far enough above beta that a shallow search won't
+    // bring it back down
+    if (params.rfp && !pv_node && !in_check && depth <= params.rfp_depth &&
+        beta > -MATE_LOWER && beta < MATE_LOWER &&
+        ss.static_eval - params.rfp_margin * depth >= beta) {
+        return ss.static_eval;
+    }
+
+    this->updateAccumulator(pos, ply);
+    if (!pv_node && can_null && !in_check && depth > NULLMOVE_DEPTH &&
+        ss.static_eval >= beta && pos.hasNonPawnMaterial(pos.turn)) {
+        pos.makeNull(ss.status);
+        int score =
+            -this->pvs(pos, -beta, 1 - beta, depth - 3, ply + 1, false);
+        pos.unmakeNull(ss.status);
 
-        for (auto m : pos.genMoves()) {
-            rest_moves.push_back({pos.value(m), m});
+        if (score >= beta) {
+            return score;
         }
+    }
 
-        std::sort(rest_moves.begin(),
-                  rest_moves.end(),
-                  std::greater<std::pair<int, Move>>());
+    // without a hash move, find one with a shallower search
+    Move tt_move = tt_hit ? entry.move : NULLMOVE;
+    if (tt_move == NULLMOVE && depth > 2) {
+        this->pvs(pos, alpha, beta, depth - 3, ply, false);
+        if (this->tt.probe(pos.key, entry)) {
+            tt_move = entry.move;
+        }
+        ss.pv_length = 0;
+    }
 
-        for (std::pair<int, Move> m_pair : rest_moves) {
-            int  val  = m_pair.first;
-            Move move = m_pair.second;
+    // quiet moves may be pruned once a move has been scored, so that a
+    // node with every move pruned is never taken for a mate
+    bool prune_quiets = !pv_node && !in_check;
+    bool futile = params.futility && depth <= params.futility_depth &&
+                  ss.static_eval + params.futility_margin * depth <= alpha;
 
-            if (val < val_lower) {
-                break;
+    Move quiets[MAX_QUIETS];
+    int  move_count = 0, quiet_count = 0, quiets_tried = 0;
+
+    MovePicker &picker = ss.picker.emplace(
+        pos, tt_move, ss.killers, &this->history, this->counterMove(ply));
+    for (Move move; picker.next(move);) {
+        if (ply == 0 && !this->isRootMove(move)) {
+            continue;
+        }
+        int  val   = pos.value(move);
+        bool quiet = !pos.isCapture(move) && !move.isPromotion();
+        if (quiet && prune_quiets && best > -MATE_LOWER) {
+            if (futile) {
+                continue;
+            }
+            if (params.lmp && depth <= params.lmp_depth &&
+                quiet_count >= params.lmp_base + depth * depth) {
+                continue;
+            }
+            // moving onto a square where it is lost for too little
+            if (params.see_pruning && depth <= params.see_depth &&
+                !pos.seeGe(move, -params.see_quiet_margin * depth)) {
+                continue;
+            }
+        }
+        quiet_count += quiet;
+
+        // at the last ply a move that can't lift the static eval over alpha
+        // is scored without a search, unless it's a check, one out of
+        // check, or on the principal variation
+        int  score;
+        bool searched = false;
+        pos.makeMove(move, ss.status);
+        bool gives_check = pos.isCheck();
+        if (depth <= 1 && !in_check && !pv_node && !gives_check &&
+            ss.static_eval + val <= alpha) {
+            pos.unmakeMove(move, ss.status);
+            score = val < MATE_LOWER ? ss.static_eval + val : MATE_UPPER;
+        } else {
+            this->tt.prefetch(pos.key);
+
+            int new_depth = depth - 1;
+            if (params.check_extensions && gives_check) {
+                new_depth++;
+            }
+
+            // the first move gets the full window, the rest a null window
+            // around alpha, and a full one again if they turn out better
+            if (move_count == 0) {
+                score = -this->pvs(pos, -beta, -alpha, new_depth, ply + 1);
+            } else {
+                // late quiet moves are searched shallower first, and again
+                // at full depth only if they beat alpha anyway
+                int r = 0;
+                if (params.lmr && quiet && !in_check && !gives_check &&
+                    depth >= params.lmr_min_depth &&
+                    move_count >= params.lmr_min_moves) {
+                    r = this->reductions[std::min(depth, 63)]
+                                        [std::min(move_count, 63)] -
+                        pv_node;
+                    r = std::max(0, std::min(r, new_depth - 1));
+                }
+
+                score = -this->pvs(
+                    pos, -alpha - 1, -alpha, new_depth - r, ply + 1);
+                if (r > 0 && score > alpha) {
+                    score = -this->pvs(
+                        pos, -alpha - 1, -alpha, new_depth, ply + 1);
+                }
+                if (score > alpha && score < beta) {
+                    score =
+                        -this->pvs(pos, -beta, -alpha, new_depth, ply + 1);
+                }
             }
 
-            if (depth <= 1 && pos.score + val < gamma) {
-                co_yield {move,
-                          val < MATE_LOWER ? pos.score + val : MATE_UPPER};
+            pos.unmakeMove(move, ss.status);
+            searched = true;
+        }
+        move_count++;
+
+        if (score > best) {
+            best = score;
+        }
+        if (score > alpha) {
+            alpha     = score;
+            best_move = move;
+
+            SearchStack &child = this->stack[ply + 1];
+            int          len   = searched ? child.pv_length : 0;
+            ss.pv[0]           = move;
+            std::copy(child.pv, child.pv + len, ss.pv + 1);
+            ss.pv_length = len + 1;
+
+            if (alpha >= beta) {
+                if (quiet) {
+                    this->updateQuietStats(
+                        pos, ply, depth, move, quiets, quiets_tried);
+                }
+                this->cutoffs++;
+                this->first_move_cutoffs += move_count == 1;
                 break;
             }
-            Position moved_board = pos.move(move);
-            co_yield {move, -this->bound(moved_board, 1 - gamma, depth - 1)};
         }
-    };
 
-    int best = -MATE_UPPER;
+        if (quiet && quiets_tried < MAX_QUIETS) {
+            quiets[quiets_tried++] = move;
+        }
+    }
 
-    auto gen = moves();
-    for (; gen.next();) {
-        auto p = gen.value();
+    if (best == -MATE_UPPER) {
+        best = in_check ? -MATE_LOWER : 0;
+    }
+    if (pv_node) {
+        best = std::min(best, max_score);
+    }
 
-        Move move  = p.first;
-        int  score = p.second;
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return best;
+    }
 
-        best = std::max(best, score);
-        if (best >= gamma) {
-            if (move != NULLMOVE) {
-                this->tp_move[pos.hash()] = move;
-            }
-            break;
+    if (ply == 0 && best_move != NULLMOVE) {
+        this->root_move = best_move;
+    }
+
+    Bound bound = best >= beta         ? BOUND_LOWER
+                  : best > alpha_orig ? BOUND_EXACT
+                                       : BOUND_UPPER;
+    this->tt.store(pos.key, depth, best, bound, best_move, ss.static_eval);
+    return best;
+}
+
+int Searcher::qsearch(Position &pos, int alpha, int beta, int ply) {
+    // only captures and queen promotions, or every evasion when in check,
+    // until the position is quiet enough for its static eval to be trusted
+    this->nodes_searched.store(
+        this->nodes_searched.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+
+    SearchStack &ss = this->stack[ply];
+    ss.pv_length    = 0;
+
+    if (ply >= MAX_PLY - 1) {
+        return pos.eval();
+    }
+
+    // every entry is deep enough for a quiescence node, but pv nodes still
+    // take no cutoffs from the table
+    bool    pv_node = beta - alpha > 1;
+    TTEntry entry;
+    bool    tt_hit = this->tt.probe(pos.key, entry);
+    if (!pv_node && tt_hit) {
+        if ((entry.bound() & BOUND_LOWER) && entry.score >= beta) {
+            return entry.score;
+        }
+        if ((entry.bound() & BOUND_UPPER) && entry.score <= alpha) {
+            return entry.score;
         }
     }
 
-    if (depth > 0 && best == -MATE_UPPER) {
-        Position flipped = pos.rotate(true);
+    ss.static_eval = tt_hit ? entry.eval : this->evaluate(pos, ply);
+    if (ss.static_eval <= -MATE_LOWER) {
+        return -MATE_UPPER;
+    }
 
-        bool in_check = this->bound(flipped, MATE_UPPER, 0, true) == MATE_UPPER;
-        best          = in_check ? -MATE_LOWER : 0;
+    int  alpha_orig = alpha;
+    int  best       = -MATE_UPPER;
+    Move best_move  = NULLMOVE;
+    bool in_check   = pos.isCheck();
+
+    // stand pat: not in check, the side to move can always decline the
+    // captures and keep the static eval
+    if (!in_check) {
+        best = ss.static_eval;
+        if (best >= beta) {
+            return best;
+        }
+        alpha = std::max(alpha, best);
     }
 
-    if (best >= gamma) {
-        this->tp_score.set(Key(pos.hash(), depth, can_null),
-                           Entry(best, entry.upper));
+    this->updateAccumulator(pos, ply);
+
+    Move        tt_move = tt_hit ? entry.move : NULLMOVE;
+    MovePicker &picker  = in_check ? ss.picker.emplace(pos, tt_move)
+                                   : ss.picker.emplace(pos, tt_move, true);
+    // out of check the picker never gets to the captures that lose
+    // material, only the ones see() calls even or better are searched
+    for (Move move; picker.next(move);) {
+        // delta pruning, the material this wins isn't enough to reach alpha
+        int val = pos.value(move);
+        if (!in_check && !move.isPromotion() &&
+            ss.static_eval + val + DELTA_MARGIN <= alpha) {
+            continue;
+        }
+
+        pos.makeMove(move, ss.status);
+        this->tt.prefetch(pos.key);
+        int score = -this->qsearch(pos, -beta, -alpha, ply + 1);
+        pos.unmakeMove(move, ss.status);
+
+        if (score > best) {
+            best = score;
+        }
+        if (score > alpha) {
+            alpha     = score;
+            best_move = move;
+            if (alpha >= beta) {
+                break;
+            }
+        }
     }
-    if (best < gamma) {
-        this->tp_score.set(Key(pos.hash(), depth, can_null),
-                           Entry(entry.lower, best));
+
+    if (in_check && best == -MATE_UPPER) {
+        best = -MATE_LOWER;
+    }
+
+    if (this->stop_search.load(std::memory_order_relaxed)) {
+        return best;
     }
+
+    Bound bound = best >= beta         ? BOUND_LOWER
+                  : best > alpha_orig ? BOUND_EXACT
+                                       : BOUND_UPPER;
+    this->tt.store(pos.key, 0, best, bound, best_move, ss.static_eval);
     return best;
 }
 
-Generator<std::tuple<int, int, Move>>
-Searcher::search(std::vector<Position> hist, int depth) {
-    this->history = hist;
+Generator<std::tuple<Bound, int, Move>> Searcher::search(int depth) {
+    return this->use_pvs ? this->searchPvs(depth) : this->searchMtd(depth);
+}
+
+Generator<std::tuple<Bound, int, Move>> Searcher::searchPvs(int depth) {
+    // aspiration windows: search a window around the last score, and widen
+    // it on the side that failed until the score lands inside
+    Position pos = this->root;
+
+    int delta = ASPIRATION_WINDOW;
+    int alpha = -MATE_UPPER, beta = MATE_UPPER;
+    if (depth >= ASPIRATION_DEPTH) {
+        alpha = std::max(this->root_score - delta, -MATE_UPPER);
+        beta  = std::min(this->root_score + delta, MATE_UPPER);
+    }
+
+    while (true) {
+        int   score = this->pvs(pos, alpha, beta, depth, 0, false);
+        Bound bound = score <= alpha  ? BOUND_UPPER
+                      : score >= beta ? BOUND_LOWER
+                                      : BOUND_EXACT;
+        co_yield std::make_tuple(bound, score, this->root_move);
+
+        if (score <= alpha) {
+            alpha = std::max(score - delta, -MATE_UPPER);
+        } else if (score >= beta) {
+            beta = std::min(score + delta, MATE_UPPER);
+        } else {
+            break;
+        }
+        delta *= 2;
+    }
+}
+
+Generator<std::tuple<Bound, int, Move>> Searcher::searchMtd(int depth) {
+    Position pos = this->root;
 
     int gamma = 0;
     int lower, upper;
 
     lower = -MATE_LOWER, upper = MATE_LOWER;
     while (lower < upper - EVAL_ROUGHNESS) {
-        int score = this->bound(hist.back(), gamma, depth, false);
+        int score = this->bound(pos, gamma, depth, 0, false);
         if (score >= gamma) {
             lower = score;
         }
@@ -158,100 +767,65 @@ Searcher::search(std::vector<Position> hist, int depth) {
             upper = score;
         }
 
+        TTEntry entry;
+        Move    move = this->root_move;
+        if (move == NULLMOVE && this->tt.probe(pos.key, entry)) {
+            move = entry.move;
+        }
+
         co_yield std::make_tuple(
-            gamma, score, this->tp_move[hist.back().hash()]);
+            score >= gamma ? BOUND_LOWER : BOUND_UPPER, score, move);
         gamma = (lower + upper + 1) / 2;
     }
 }
 
-void Searcher::searchTimed(std::vector<Position> &hist, int ms_time) {
-    this->stop_search      = false;
-    auto        start_time = Clock::now();
-    std::string move_str;
-    bool        flip_side = !hist.size() % 2;
-    for (int depth = 1; depth < 1000; depth++) {
-        if (stop_search) {
-            break;
-        }
-
-        auto result_moves_gen = search(hist, depth);
-        for (; result_moves_gen.next();) {
-            if (stop_search) {
-                break;
-            }
-
-            int  gamma, score;
-            Move move;
-
-            auto result                  = result_moves_gen.value();
-            std::tie(gamma, score, move) = result;
-            move_str =
-                render(move.i) + render(move.j) +
-                (move.prom != ' ' ? (const char *)tolower(move.prom) : "");
-
-            printPvInfo(move, depth, score, start_time, flip_side);
+std::vector<Move> Searcher::principalVariation(int depth) const {
+    const SearchStack &root = this->stack[0];
+    if (this->use_pvs && root.pv_length > 0) {
+        return std::vector<Move>(root.pv, root.pv + root.pv_length);
+    }
 
-            if (deltaMs(std::chrono::high_resolution_clock::now(), start_time) >
-                ms_time) {
-                stop_search = true;
-                break;
-            }
-        }
+    // mtd-bi keeps no pv, follow the hash moves from the root instead
+    std::vector<Move> pv;
+    Position          pos = this->root;
+    for (TTEntry entry; (int)pv.size() < std::max(depth, 1) &&
+                        this->tt.probe(pos.key, entry) &&
+                        pos.isLegal(entry.move);) {
+        pv.push_back(entry.move);
+        pos = pos.move(entry.move);
     }
 
-    std::cout << "bestmove " << (move_str.length() ? move_str : "(none)")
-              << std::endl;
+    if (pv.empty() && this->root_move != NULLMOVE) {
+        pv.push_back(this->root_move);
+    }
+    return pv;
 }
 
-void Searcher::searchInfinite(std::vector<Position> &hist) {
-    std::string move_str;
-    this->stop_search = false;
-    auto start_time   = Clock::now();
-
-    bool flip_side = !hist.size() % 2;
+// lazy smp: each helper thread skips a different set of depths, so that
+// the threads spread over depths and fill the shared hash table for each
+// other, with SKIP_SIZE[k] depths searched, then SKIP_SIZE[k] skipped
+static const int SKIP_COUNT             = 20;
+static const int SKIP_SIZE[SKIP_COUNT]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                           3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+static const int SKIP_PHASE[SKIP_COUNT] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3,
+                                           4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+void Searcher::searchHelper() {
+    int k = (this->id - 1) % SKIP_COUNT;
+
+    for (int depth = 1; depth < MAX_PLY && !this->stop_search; depth++) {
+        if (((depth + SKIP_PHASE[k]) / SKIP_SIZE[k]) % 2) {
+            continue;
+        }
 
-    for (int depth = 1; !stop_search; depth++) {
-        for (auto result_moves_gen = search(hist, depth);
-             result_moves_gen.next();) {
-            if (stop_search) {
-                break;
-            }
-            auto result = result_moves_gen.value();
-            int  gamma, score;
-            Move move;
-            std::tie(gamma, score, move) = result;
+        int score = 0;
+        for (auto gen = this->search(depth); gen.next();) {
+            score = std::get<1>(gen.value());
+        }
 
-            printPvInfo(move, depth, score, start_time, flip_side);
+        if (!this->stop_search) {
+            this->root_score      = score;
+            this->completed_depth = depth;
         }
     }
-    std::cout << "bestmove " << (move_str.length() ? move_str : "(none)")
-              << std::endl;
 }
-
-void Searcher::printPvInfo(Move                                  move,
-                           int                                   depth,
-                           int                                   score,
-                           std::chrono::steady_clock::time_point start_time,
-                           bool                                  flip_side) {
-    int i = move.i, j = move.j;
-    if (flip_side) {
-        i = 119 - i, j = 119 - j;
-    }
-    std::string move_str =
-        render(i) + render(j) +
-        (move.prom != ' ' ? (const char *)tolower(move.prom) : "");
-
-    int time = std::chrono::duration_cast<std::chrono::milliseconds>(
-                   std::chrono::high_resolution_clock::now() - start_time)
-                   .count();
-
-    std::cout << "info depth " << depth << " score cp " << score << " nodes "
-              << this->nodes_searched << " nps "
-              << (this->nodes_searched * 1000) / time << " hashfull "
-              << this->tp_score.getPermillFull() << " time " << time << " pv "
-              << move_str << std::endl;
-}
-
-void Searcher::stopSearch() {
-    this->stop_search = true;
-}
\ No newline at end of file
@@ -4,45 +4,143 @@
 #include <atomic>
 #include <functional>
 #include <iostream>
-#include <map>
+#include <optional>
 #include <tuple>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "../consts.h"
+#include "../endgame.h"
 #include "../move.h"
 #include "../position.h"
 #include "../utils/generator.h"
-#include "../utils/hashtable.h"
+#include "evalcache.h"
+#include "history.h"
+#include "movepicker.h"
+#include "nnue.h"
+#include "tablebases.h"
+#include "pawns.h"
+#include "transpositiontable.h"
 
-const int mb_size = 16; // TODO: move the mb_size to the UCI options
+struct SearchStack { // what bound() keeps for each ply of the search path
+    Status                    status;
+    Accumulator               acc;         // the network's, see below
+    ui64                      acc_key = 0; // of the position acc is for
+    std::optional<MovePicker> picker; // emplaced in place, never allocates
+    Move                      killers[KILLER_SLOTS];
+    int                       static_eval = 0;
+    Move                      pv[MAX_PLY]; // from this ply on, pvs only
+    int                       pv_length = 0;
+};
+
+struct SearchParams { // the pruning switches and their margins, see options.h
+    bool lmr           = true; // late move reductions
+    int  lmr_base      = 75;   // in hundredths of a ply
+    int  lmr_divisor   = 225;  // in hundredths
+    int  lmr_min_depth = 3;
+    int  lmr_min_moves = 3;
+
+    bool rfp        = true; // reverse futility pruning
+    int  rfp_depth  = 6;
+    int  rfp_margin = 80; // per ply
+
+    bool futility        = true; // futility pruning of quiet moves
+    int  futility_depth  = 6;
+    int  futility_margin = 100; // per ply
 
-class Searcher {
+    bool lmp       = true; // late move pruning
+    int  lmp_depth = 4;
+    int  lmp_base  = 3; // quiet moves kept: lmp_base + depth * depth
+
+    bool see_pruning      = true; // of quiet moves that lose material
+    int  see_depth        = 8;
+    int  see_quiet_margin = 60; // per ply, what a quiet move may give up
+
+    bool check_extensions = true;
+
+    int  tb_cardinality = 0; // the most pieces probed, 0 for none
+    int  tb_probe_depth = 1; // at that many pieces, the least depth probed
+    bool tb_rule50      = true; // cursed wins and blessed losses are draws
+};
+
+class Searcher { // one search thread, see ThreadPool
   public:
-    Searcher()
-        : tp_score{mb_size, Entry(-MATE_UPPER, MATE_UPPER)} {}
-    FixedSizeHashTable<Key, Entry> tp_score;
-    std::map<PositionHash, Move>   tp_move;
+    Searcher(TranspositionTable &_tt,
+             const Network      &_network,
+             std::atomic<bool>  &_stop_search,
+             int                 _id)
+        : tt(_tt)
+        , network(_network)
+        , stop_search(_stop_search)
+        , id(_id) {
+        this->history.clear();
+        this->eval_cache.clear();
+    }
+
+    TranspositionTable &tt;          // shared by all threads
+    const Network      &network;     // shared by all threads
+    std::atomic<bool>  &stop_search; // shared by all threads
+    int                 id;          // 0 is the main thread
+
+    Position          root;
+    std::vector<ui64> keys; // of the game up to the root, then the search path
+    std::size_t       root_index = 0; // of the root in keys
+    std::atomic<ui64> nodes_searched = 0;
+    std::atomic<ui64> tb_hits        = 0;
+    MoveList          root_moves; // the ones searched, or all when empty
+
+    Move root_move       = NULLMOVE; // the last move to fail high at the root
+    int  root_score      = 0;
+    int  completed_depth = 0;
+    bool use_pvs         = true;  // alpha-beta pvs, otherwise mtd-bi
+    bool use_nnue        = false; // the network's eval, otherwise the psqt
+
+    SearchParams params;
+    int          reductions[64][64] = {}; // by depth and move number
+
+    SearchStack   stack[MAX_PLY]; // indexed by ply
+    MoveHistory   history;        // kept from one search to the next
+    PawnTable     pawns;          // likewise, for the psqt eval
+    MaterialTable material;       // the endings and scale factors, for both
+    EvalCache     eval_cache;     // of whichever eval use_nnue picks
+
+    ui64 cutoffs            = 0; // of this search, to measure move ordering
+    ui64 first_move_cutoffs = 0;
 
-    std::vector<Position> history;
-    int                   nodes_searched = 0;
+    void setParams(const SearchParams &_params);
+    void setRoot(const std::vector<Position> &hist);
+    bool isRepetition(const Position &pos, int ply) const;
+    bool isRootMove(const Move &move) const;
+    bool probeTablebases(Position &pos, int depth, int &score, Bound &bound);
+    Move counterMove(int ply) const;
+    int  evaluate(const Position &pos, int ply);
+    void updateAccumulator(const Position &pos, int ply);
+    void updateQuietStats(const Position &pos,
+                          int             ply,
+                          int             depth,
+                          const Move     &move,
+                          const Move     *quiets,
+                          int             quiet_count);
 
-    int bound(Position &pos, int gamma, int depth, bool can_null);
-    Generator<std::tuple<int, int, Move>> search(std::vector<Position> hist,
-                                                 int                   depth);
+    int bound(Position &pos, int gamma, int depth, int ply, bool can_null);
+    int pvs(Position &pos,
+            int       alpha,
+            int       beta,
+            int       depth,
+            int       ply,
+            bool      can_null);
+    int qsearch(Position &pos, int alpha, int beta, int ply);
 
-    void searchTimed(std::vector<Position> &hist, int ms_time);
-    void searchInfinite(std::vector<Position> &hist);
-    void stopSearch();
+    // yields a (bound, score, root move) after each search from the root,
+    // the bound telling whether the score failed low, high or is exact
+    Generator<std::tuple<Bound, int, Move>> search(int depth);
+    Generator<std::tuple<Bound, int, Move>> searchMtd(int depth);
+    Generator<std::tuple<Bound, int, Move>> searchPvs(int depth);
 
-    void printPvInfo(Move                                  move,
-                     int                                   depth,
-                     int                                   score,
-                     std::chrono::steady_clock::time_point start_time,
-                     bool                                  flip_side);
+    std::vector<Move> principalVariation(int depth) const;
 
-    std::atomic<bool> stop_search;
+    void searchHelper();
 };
 
-#endif // !KINGFISH_SEARCHER_H
\ No newline at end of file
+#endif // !KINGFISH_SEARCHER_H
@@ -0,0 +1,1248 @@
+#include "tablebases.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../bits.h"
+#include "../consts.h"
+#include "../zobrist.h"
+
+// The format is that of the Syzygy generator, the probing code follows the
+// reference one. Its squares run from a1 = 0 to h8 = 63, its pieces are
+// numbered 1 to 6 for white's pawn to king and 9 to 14 for black's, and a
+// position is indexed with its strong side as white.
+
+const int TB_PIECES = 7;
+const int MAX_DTZ   = 1 << 18; // above any dtz, for the root ranks
+
+int Tablebases::max_cardinality = 0;
+
+typedef ui8 TBType;
+
+enum TBTypes { TB_WDL, TB_DTZ };
+
+enum TBFlags { // of each table in a file
+
+    TB_STM          = 1, // the side to move a DTZ table is for
+    TB_MAPPED       = 2, // DTZ values are remapped, see mapScore
+    TB_WIN_PLIES    = 4, // DTZ wins in plies, otherwise in moves
+    TB_LOSS_PLIES   = 8,
+    TB_WIDE         = 16, // the DTZ map has 16 bit values
+    TB_SINGLE_VALUE = 128 // every position has the same value
+
+};
+
+static inline int tbSquare(Square square) {
+    return square ^ 56; // a8 is 0 on our board
+}
+
+static inline int tbPiece(Piece piece) {
+    return (piece.getType() + 1) | (piece.getColor() == CL_BLACK ? 8 : 0);
+}
+
+// above or below the a1-h8 diagonal, 0 on it
+static inline int offA1H8(int square) {
+    return (square >> 3) - (square & 7);
+}
+
+template <typename T> static inline int signOf(T value) {
+    return (T(0) < value) - (value < T(0));
+}
+
+// the files are little endian but for the huffman codes
+template <typename T> static inline T readLE(const void *addr) {
+    T value;
+    std::memcpy(&value, addr, sizeof(T));
+    if constexpr (std::endian::native != std::endian::little) {
+        ui8 *bytes = reinterpret_cast<ui8 *>(&value);
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    return value;
+}
+
+template <typename T> static inline T readBE(const void *addr) {
+    T value;
+    std::memcpy(&value, addr, sizeof(T));
+    if constexpr (std::endian::native != std::endian::big) {
+        ui8 *bytes = reinterpret_cast<ui8 *>(&value);
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    return value;
+}
+
+// the indexing tables, see initIndexing
+static int map_pawns[64];
+static int map_b1h1h7[64];
+static int map_a1d1d4[64];
+static int map_kk[10][64];
+static int binomial[6][64];        // [k][n], k of n squares
+static int lead_pawn_idx[6][64];   // [lead pawn count][square]
+static int lead_pawns_size[6][4];  // [lead pawn count][file a to d]
+
+static bool pawnsCompare(int a, int b) {
+    return map_pawns[a] < map_pawns[b];
+}
+
+typedef ui16 Sym; // a huffman symbol
+
+struct SparseEntry { // little endian, a block and an offset in it
+    char block[4];
+    char offset[2];
+};
+
+static_assert(sizeof(SparseEntry) == 6);
+
+struct LR { // the two symbols a symbol stands for, 12 bits each
+    ui8 lr[3];
+
+    inline Sym left() const { return Sym(((lr[1] & 0xF) << 8) | lr[0]); }
+    inline Sym right() const { return Sym((lr[2] << 4) | (lr[1] >> 4)); }
+};
+
+static_assert(sizeof(LR) == 3);
+
+// What it takes to decompress one table of a file, there is one for each
+// side to move of a WDL file with different material for the sides, and
+// one for each file of the leading pawn in a file with pawns. Set up when
+// the file is mapped.
+struct PairsData {
+    ui8                flags       = 0; // TBFlags
+    ui8                max_sym_len = 0; // of the huffman codes, in bits
+    ui8                min_sym_len = 0; // the value of a single value table
+    ui32               num_blocks  = 0;
+    std::size_t        block_size  = 0;
+    std::size_t        span = 0; // values between sparse index entries
+    const Sym         *lowest_sym        = nullptr; // by code length
+    const LR          *btree             = nullptr; // by symbol
+    const ui16        *block_length      = nullptr; // values - 1, by block
+    ui32               block_length_size = 0;
+    const SparseEntry *sparse_index      = nullptr;
+    std::size_t        sparse_index_size = 0;
+    const ui8         *data              = nullptr; // the blocks
+    std::vector<ui64>  base64; // the lowest code of each length, padded
+    std::vector<ui8>   symlen; // the values of each symbol, minus one
+    int                pieces[TB_PIECES] = {}; // in the order encoded
+    ui64               group_idx[TB_PIECES + 1] = {};
+    int                group_len[TB_PIECES + 1] = {}; // KRKN: 3, 1, 0
+    ui16               map_idx[4] = {}; // DTZ only, see mapScore
+};
+
+template <TBType TYPE> struct TBTable { // one file, found by init
+    static constexpr int SIDES = TYPE == TB_WDL ? 2 : 1;
+
+    std::atomic<bool> ready   = false; // mapped, or found missing
+    void             *base    = nullptr;
+    std::size_t       mapping = 0;
+    const ui8        *map     = nullptr; // the DTZ value maps
+    ui64              key     = 0; // with the stronger side white
+    ui64              key2    = 0; // and black
+    int               piece_count       = 0;
+    bool              has_pawns         = false;
+    bool              has_unique_pieces = false;
+    ui8               pawn_count[2]     = {}; // the leading side's first
+    PairsData         items[SIDES][4]; // by side to move and pawn file
+
+    TBTable() = default;
+    TBTable(const TBTable &) = delete;
+
+    ~TBTable() {
+        if (this->base) {
+            munmap(this->base, this->mapping);
+        }
+    }
+
+    inline PairsData *get(int stm, int file) {
+        return &this->items[stm % SIDES][this->has_pawns ? file : 0];
+    }
+};
+
+struct TBEntry {
+    TBTable<TB_WDL> *wdl;
+    TBTable<TB_DTZ> *dtz;
+};
+
+// the tables found, by the material keys of both colourings
+static std::deque<TBTable<TB_WDL>>           wdl_tables;
+static std::deque<TBTable<TB_DTZ>>           dtz_tables;
+static std::unordered_map<ui64, TBEntry>     tables;
+static std::string                           tb_paths;
+
+// the first of the paths that has the file, or ""
+static std::string findFile(const std::string &name) {
+    std::stringstream ss(tb_paths);
+    for (std::string dir; std::getline(ss, dir, ':');) {
+        std::string path = dir + "/" + name;
+        if (!dir.empty() && std::ifstream(path).good()) {
+            return path;
+        }
+    }
+    return "";
+}
+
+// maps the file read only and shared, and returns its data past the magic,
+// or nullptr when it is missing or isn't a table of the type
+static const ui8 *
+mapFile(const std::string &name, TBType type, void *&base, std::size_t &size) {
+    static constexpr ui8 MAGICS[2][4] = {{0x71, 0xE8, 0x23, 0x5D},  // wdl
+                                         {0xD7, 0x66, 0x0C, 0xA5}}; // dtz
+
+    std::string path = findFile(name);
+    int         fd   = path.empty() ? -1 : ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size % 64 != 16) {
+        ::close(fd);
+        std::cout << "info string corrupt tablebase " << path << std::endl;
+        return nullptr;
+    }
+
+    void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cout << "info string could not map " << path << std::endl;
+        return nullptr;
+    }
+#if defined(MADV_RANDOM)
+    // probes jump all over the file, reading ahead only wastes memory
+    madvise(mem, st.st_size, MADV_RANDOM);
+#endif
+
+    if (std::memcmp(mem, MAGICS[type], 4) != 0) {
+        munmap(mem, st.st_size);
+        std::cout << "info string corrupt tablebase " << path << std::endl;
+        return nullptr;
+    }
+
+    base = mem;
+    size = st.st_size;
+    return static_cast<const ui8 *>(mem) + 4;
+}
+
+// The values are compressed by recursive pairing, each symbol standing for
+// a pair of symbols and in the end for up to 256 values, and the symbols
+// with a canonical huffman code. The blocks of data hold up to 65536
+// values each, the sparse index points into the blocks every span values.
+static int decompressPairs(const PairsData *d, ui64 idx) {
+    if (d->flags & TB_SINGLE_VALUE) {
+        return d->min_sym_len;
+    }
+
+    // the sparse entry nearest to idx, then the block idx is in
+    ui32 k      = ui32(idx / d->span);
+    ui32 block  = readLE<ui32>(d->sparse_index[k].block);
+    int  offset = readLE<ui16>(d->sparse_index[k].offset);
+    offset += int(idx % d->span) - int(d->span / 2);
+
+    while (offset < 0) {
+        offset += readLE<ui16>(&d->block_length[--block]) + 1;
+    }
+    while (offset > readLE<ui16>(&d->block_length[block])) {
+        offset -= readLE<ui16>(&d->block_length[block++]) + 1;
+    }
+
+    // the symbols of the block one after the other until the one that
+    // holds the value at offset
+    const ui8 *ptr = d->data + ui64(block) * d->block_size;
+
+    ui64 buf64      = readBE<ui64>(ptr);
+    int  buf64_size = 64;
+    Sym  sym;
+    ptr += 8;
+
+    while (true) {
+        // the longer codes are the lower ones, see setSizes
+        int len = 0;
+        while (buf64 < d->base64[len]) {
+            len++;
+        }
+
+        sym = Sym((buf64 - d->base64[len]) >> (64 - len - d->min_sym_len));
+        sym += readLE<Sym>(&d->lowest_sym[len]);
+
+        if (offset < d->symlen[sym] + 1) {
+            break;
+        }
+        offset -= d->symlen[sym] + 1;
+
+        len += d->min_sym_len;
+        buf64 <<= len;
+        buf64_size -= len;
+        if (buf64_size <= 32) {
+            buf64_size += 32;
+            buf64 |= ui64(readBE<ui32>(ptr)) << (64 - buf64_size);
+            ptr += 4;
+        }
+    }
+
+    // then down the pairs to the value
+    while (d->symlen[sym]) {
+        Sym left = d->btree[sym].left();
+        if (offset < d->symlen[left] + 1) {
+            sym = left;
+        } else {
+            offset -= d->symlen[left] + 1;
+            sym = d->btree[sym].right();
+        }
+    }
+
+    return d->btree[sym].left();
+}
+
+static bool checkDtzStm(TBTable<TB_WDL> *, int, int) {
+    return true;
+}
+
+// a DTZ table only has one side to move, a symmetric one without pawns
+// either since it can swap the colours
+static bool checkDtzStm(TBTable<TB_DTZ> *entry, int stm, int file) {
+    int flags = entry->get(stm, file)->flags;
+    return (flags & TB_STM) == stm ||
+           (entry->key == entry->key2 && !entry->has_pawns);
+}
+
+static int mapScore(TBTable<TB_WDL> *, int, int value, WDLScore) {
+    return value - 2;
+}
+
+// DTZ values are stored by how often they occur for each WDL result, and
+// in moves rather than plies where that doesn't lose anything
+static int mapScore(TBTable<TB_DTZ> *entry, int file, int value, WDLScore wdl) {
+    constexpr int WDL_MAP[] = {1, 3, 0, 2, 0};
+
+    const PairsData *d   = entry->get(0, file);
+    int              idx = d->map_idx[WDL_MAP[wdl + 2]];
+    if (d->flags & TB_MAPPED) {
+        value = d->flags & TB_WIDE
+                    ? readLE<ui16>(entry->map + 2 * (idx + value))
+                    : entry->map[idx + value];
+    }
+
+    if ((wdl == WDL_WIN && !(d->flags & TB_WIN_PLIES)) ||
+        (wdl == WDL_LOSS && !(d->flags & TB_LOSS_PLIES)) ||
+        wdl == WDL_CURSED_WIN || wdl == WDL_BLESSED_LOSS) {
+        value *= 2;
+    }
+
+    return value + 1;
+}
+
+// The index of a position: the leading pieces or pawns are mirrored into
+// a corner of the board and indexed together, then each group of the same
+// pieces by the squares still free, k of them on sorted squares
+// s1 < ... < sk as binomial[1][s1] + ... + binomial[k][sk].
+template <TBType TYPE>
+static int doProbeTable(const Position  &pos,
+                        TBTable<TYPE>   *entry,
+                        WDLScore         wdl,
+                        ProbeState      &result) {
+    int      squares[TB_PIECES];
+    int      pieces[TB_PIECES];
+    ui64     idx;
+    int      next = 0, size = 0, lead_pawns_count = 0;
+    Bitboard b, lead_pawns = 0;
+    int      tb_file = 0;
+
+    // the table has white as the stronger side, and only white to move
+    // when both sides have the same pieces, the position is flipped to it
+    bool symmetric_btm = entry->key == entry->key2 && pos.turn == CL_BLACK;
+    bool flip          = symmetric_btm || pos.material_key != entry->key;
+    int  flip_color    = flip ? 8 : 0;
+    int  flip_squares  = flip ? 56 : 0;
+    int  stm           = flip ^ (pos.turn == CL_BLACK);
+
+    // with pawns the table is split by the file of the leading pawn, the
+    // one nearest the edge and then the lowest
+    if (entry->has_pawns) {
+        int   pc    = entry->get(0, 0)->pieces[0] ^ flip_color;
+        Color color = pc & 8 ? CL_BLACK : CL_WHITE;
+
+        lead_pawns = b = pos.pieces(color, PT_PAWN);
+        while (b) {
+            squares[size++] = tbSquare(bits::popLsb(b)) ^ flip_squares;
+        }
+        lead_pawns_count = size;
+
+        std::swap(squares[0],
+                  *std::max_element(
+                      squares, squares + lead_pawns_count, pawnsCompare));
+        tb_file = std::min(squares[0] & 7, 7 - (squares[0] & 7));
+    }
+
+    if (!checkDtzStm(entry, stm, tb_file)) {
+        result = PROBE_CHANGE_STM;
+        return 0;
+    }
+
+    b = pos.occupied() ^ lead_pawns;
+    while (b) {
+        Square square   = bits::popLsb(b);
+        squares[size]   = tbSquare(square) ^ flip_squares;
+        pieces[size++]  = tbPiece(pos.board[square]) ^ flip_color;
+    }
+
+    // in the order the table encodes them
+    PairsData *d = entry->get(stm, tb_file);
+    for (int i = lead_pawns_count; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (d->pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // the leading piece to files a to d
+    if ((squares[0] & 7) > 3) {
+        for (int i = 0; i < size; i++) {
+            squares[i] ^= 7;
+        }
+    }
+
+    if (entry->has_pawns) {
+        idx = lead_pawn_idx[lead_pawns_count][squares[0]];
+
+        std::stable_sort(squares + 1, squares + lead_pawns_count, pawnsCompare);
+        for (int i = 1; i < lead_pawns_count; i++) {
+            idx += binomial[i][map_pawns[squares[i]]];
+        }
+    } else {
+        // without pawns, to ranks 1 to 4 and then below the a1-h8 diagonal
+        // as well, the first of the leading group off it decides
+        if ((squares[0] >> 3) > 3) {
+            for (int i = 0; i < size; i++) {
+                squares[i] ^= 56;
+            }
+        }
+
+        for (int i = 0; i < d->group_len[0]; i++) {
+            if (!offA1H8(squares[i])) {
+                continue;
+            }
+            if (offA1H8(squares[i]) > 0) {
+                for (int j = i; j < size; j++) {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (entry->has_unique_pieces) {
+            // the first three pieces together, the others shifted down past
+            // the squares taken before them
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+            if (offA1H8(squares[0])) {
+                idx = (map_a1d1d4[squares[0]] * 63 + (squares[1] - adjust1)) *
+                          62 +
+                      squares[2] - adjust2;
+            } else if (offA1H8(squares[1])) {
+                idx = (6 * 63 + (squares[0] >> 3) * 28 +
+                       map_b1h1h7[squares[1]]) *
+                          62 +
+                      squares[2] - adjust2;
+            } else if (offA1H8(squares[2])) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + (squares[0] >> 3) * 7 * 28 +
+                      ((squares[1] >> 3) - adjust1) * 28 +
+                      map_b1h1h7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 +
+                      (squares[0] >> 3) * 7 * 6 +
+                      ((squares[1] >> 3) - adjust1) * 6 +
+                      ((squares[2] >> 3) - adjust2);
+            }
+        } else {
+            // no piece but the kings is alone, so they lead
+            idx = map_kk[map_a1d1d4[squares[0]]][squares[1]];
+        }
+    }
+
+    idx *= d->group_idx[0];
+
+    // the other groups, the other side's pawns first if it has any
+    int *group_sq        = squares + d->group_len[0];
+    bool remaining_pawns = entry->has_pawns && entry->pawn_count[1];
+    while (d->group_len[++next]) {
+        std::stable_sort(group_sq, group_sq + d->group_len[next]);
+
+        ui64 n = 0;
+        for (int i = 0; i < d->group_len[next]; i++) {
+            int adjust = int(std::count_if(
+                squares, group_sq, [&](int s) { return group_sq[i] > s; }));
+            n += binomial[i + 1][group_sq[i] - adjust - 8 * remaining_pawns];
+        }
+
+        remaining_pawns = false;
+        idx += n * d->group_idx[next];
+        group_sq += d->group_len[next];
+    }
+
+    return mapScore(entry, tb_file, decompressPairs(d, idx), wdl);
+}
+
+// The pieces are encoded in groups, each of the same piece but the leading
+// one, of the pawns or of three unique pieces or of the kings: KRKN is
+// KRK + N, KNNK is KK + NN and KPPKP is P + PP + K + K. The order the
+// groups are multiplied together in is the table's own.
+template <typename T>
+static void setGroups(T &e, PairsData *d, const int order[], int file) {
+    int n = 0, first_len = e.has_pawns ? 0 : e.has_unique_pieces ? 3 : 2;
+
+    d->group_len[n] = 1;
+    for (int i = 1; i < e.piece_count; i++) {
+        if (--first_len > 0 || d->pieces[i] == d->pieces[i - 1]) {
+            d->group_len[n]++;
+        } else {
+            d->group_len[++n] = 1;
+        }
+    }
+    d->group_len[++n] = 0;
+
+    bool pp           = e.has_pawns && e.pawn_count[1]; // on both sides
+    int  next         = pp ? 2 : 1;
+    int  free_squares = 64 - d->group_len[0] - (pp ? d->group_len[1] : 0);
+    ui64 idx          = 1;
+
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            d->group_idx[0] = idx;
+            if (e.has_pawns) {
+                idx *= lead_pawns_size[d->group_len[0]][file];
+            } else {
+                idx *= e.has_unique_pieces ? 31332 : 462;
+            }
+        } else if (k == order[1]) {
+            d->group_idx[1] = idx;
+            idx *= binomial[d->group_len[1]][48 - d->group_len[0]];
+        } else {
+            d->group_idx[next] = idx;
+            idx *= binomial[d->group_len[next]][free_squares];
+            free_squares -= d->group_len[next++];
+        }
+    }
+
+    d->group_idx[n] = idx;
+}
+
+// how many values a symbol stands for, minus one, from its pair
+static ui8 setSymlen(PairsData *d, Sym s, std::vector<bool> &visited) {
+    visited[s] = true; // the pairs are a tree, so no cycle to fear
+    Sym right  = d->btree[s].right();
+    if (right == 0xFFF) {
+        return 0;
+    }
+
+    Sym left = d->btree[s].left();
+    if (!visited[left]) {
+        d->symlen[left] = setSymlen(d, left, visited);
+    }
+    if (!visited[right]) {
+        d->symlen[right] = setSymlen(d, right, visited);
+    }
+    return d->symlen[left] + d->symlen[right] + 1;
+}
+
+static const ui8 *setSizes(PairsData *d, const ui8 *data) {
+    d->flags = *data++;
+    if (d->flags & TB_SINGLE_VALUE) {
+        d->min_sym_len = *data++; // the value
+        return data;
+    }
+
+    // the last group index is the size of the table
+    ui64 tb_size =
+        d->group_idx[std::find(d->group_len, d->group_len + TB_PIECES, 0) -
+                     d->group_len];
+
+    d->block_size        = std::size_t(1) << *data++;
+    d->span              = std::size_t(1) << *data++;
+    d->sparse_index_size = std::size_t((tb_size + d->span - 1) / d->span);
+    int padding          = *data++;
+    d->num_blocks        = readLE<ui32>(data);
+    data += sizeof(ui32);
+    // padded so that the sparse index never points past it
+    d->block_length_size = d->num_blocks + padding;
+    d->max_sym_len       = *data++;
+    d->min_sym_len       = *data++;
+    d->lowest_sym        = reinterpret_cast<const Sym *>(data);
+    d->base64.resize(d->max_sym_len - d->min_sym_len + 1);
+
+    // In a canonical huffman code the longer codes have the lower values,
+    // base64[i] is the lowest code of length min_sym_len + i padded to 64
+    // bits, so that a code of that length read in 64 bits lies between
+    // base64[i] and base64[i - 1].
+    for (int i = int(d->base64.size()) - 2; i >= 0; i--) {
+        d->base64[i] = (d->base64[i + 1] + readLE<Sym>(&d->lowest_sym[i]) -
+                        readLE<Sym>(&d->lowest_sym[i + 1])) /
+                       2;
+    }
+    for (std::size_t i = 0; i < d->base64.size(); i++) {
+        d->base64[i] <<= 64 - i - d->min_sym_len;
+    }
+
+    data += d->base64.size() * sizeof(Sym);
+    d->symlen.resize(readLE<ui16>(data));
+    data += sizeof(ui16);
+    d->btree = reinterpret_cast<const LR *>(data);
+
+    std::vector<bool> visited(d->symlen.size());
+    for (std::size_t sym = 0; sym < d->symlen.size(); sym++) {
+        if (!visited[sym]) {
+            d->symlen[sym] = setSymlen(d, Sym(sym), visited);
+        }
+    }
+
+    return data + d->symlen.size() * sizeof(LR) + (d->symlen.size() & 1);
+}
+
+static const ui8 *setDtzMap(TBTable<TB_WDL> &, const ui8 *data, int) {
+    return data;
+}
+
+static const ui8 *setDtzMap(TBTable<TB_DTZ> &e, const ui8 *data, int max_file) {
+    e.map = data;
+
+    // four maps, one for each WDL result, each after its length
+    for (int f = 0; f <= max_file; f++) {
+        PairsData *d = e.get(0, f);
+        if (!(d->flags & TB_MAPPED)) {
+            continue;
+        }
+        if (d->flags & TB_WIDE) {
+            data += std::uintptr_t(data) & 1;
+            for (int i = 0; i < 4; i++) {
+                d->map_idx[i] = ui16((data - e.map) / 2 + 1);
+                data += 2 * readLE<ui16>(data) + 2;
+            }
+        } else {
+            for (int i = 0; i < 4; i++) {
+                d->map_idx[i] = ui16(data - e.map + 1);
+                data += *data + 1;
+            }
+        }
+    }
+
+    return data + (std::uintptr_t(data) & 1);
+}
+
+// reads the headers of a just mapped file into its PairsData
+template <typename T> static void setup(T &e, const ui8 *data) {
+    data++; // the split and pawn flags, which init already knows
+
+    const int sides    = T::SIDES == 2 && e.key != e.key2 ? 2 : 1;
+    const int max_file = e.has_pawns ? 3 : 0;
+    const bool pp      = e.has_pawns && e.pawn_count[1];
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            *e.get(i, f) = PairsData();
+        }
+
+        int order[2][2] = {{*data & 0xF, pp ? *(data + 1) & 0xF : 0xF},
+                           {*data >> 4, pp ? *(data + 1) >> 4 : 0xF}};
+        data += 1 + pp;
+
+        for (int k = 0; k < e.piece_count; k++, data++) {
+            for (int i = 0; i < sides; i++) {
+                e.get(i, f)->pieces[k] = i ? *data >> 4 : *data & 0xF;
+            }
+        }
+
+        for (int i = 0; i < sides; i++) {
+            setGroups(e, e.get(i, f), order[i], f);
+        }
+    }
+
+    data += std::uintptr_t(data) & 1;
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            data = setSizes(e.get(i, f), data);
+        }
+    }
+
+    data = setDtzMap(e, data, max_file);
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            PairsData *d    = e.get(i, f);
+            d->sparse_index = reinterpret_cast<const SparseEntry *>(data);
+            data += d->sparse_index_size * sizeof(SparseEntry);
+        }
+    }
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            PairsData *d    = e.get(i, f);
+            d->block_length = reinterpret_cast<const ui16 *>(data);
+            data += d->block_length_size * sizeof(ui16);
+        }
+    }
+
+    for (int f = 0; f <= max_file; f++) {
+        for (int i = 0; i < sides; i++) {
+            // the blocks start on a cache line
+            data = reinterpret_cast<const ui8 *>(
+                (std::uintptr_t(data) + 0x3F) & ~std::uintptr_t(0x3F));
+            PairsData *d = e.get(i, f);
+            d->data      = data;
+            data += d->num_blocks * d->block_size;
+        }
+    }
+}
+
+// maps the table's file at its first probe, by whichever thread gets there
+// first, the others wait for it
+template <TBType TYPE>
+static bool mapped(TBTable<TYPE> &e, const Position &pos) {
+    static std::mutex mutex;
+
+    if (e.ready.load(std::memory_order_acquire)) {
+        return e.base != nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (e.ready.load(std::memory_order_relaxed)) {
+        return e.base != nullptr;
+    }
+
+    // the pieces of each side from the king down, "KRvKP"
+    const std::string PIECES = "PNBRQK";
+
+    std::string w, b;
+    for (PieceType pt = PT_KING; pt >= PT_PAWN; pt--) {
+        w += std::string(bits::popcount(pos.pieces(CL_WHITE, pt)), PIECES[pt]);
+        b += std::string(bits::popcount(pos.pieces(CL_BLACK, pt)), PIECES[pt]);
+    }
+    std::string name = (e.key == pos.material_key ? w + 'v' + b : b + 'v' + w) +
+                       (TYPE == TB_WDL ? ".rtbw" : ".rtbz");
+
+    const ui8 *data = mapFile(name, TYPE, e.base, e.mapping);
+    if (data) {
+        setup(e, data);
+    }
+
+    e.ready.store(true, std::memory_order_release);
+    return e.base != nullptr;
+}
+
+template <TBType TYPE>
+static int probeTable(const Position &pos,
+                      ProbeState     &result,
+                      WDLScore        wdl = WDL_DRAW) {
+    if (bits::popcount(pos.occupied()) == 2) {
+        return WDL_DRAW; // the kings alone, and no file for them
+    }
+
+    auto found = tables.find(pos.material_key);
+    if (found == tables.end()) {
+        result = PROBE_FAIL;
+        return 0;
+    }
+
+    TBTable<TYPE> *entry;
+    if constexpr (TYPE == TB_WDL) {
+        entry = found->second.wdl;
+    } else {
+        entry = found->second.dtz;
+    }
+
+    if (!mapped(*entry, pos)) {
+        result = PROBE_FAIL;
+        return 0;
+    }
+    return doProbeTable(pos, entry, wdl, result);
+}
+
+// The generator stores whatever compresses best where a capture is at
+// least as good as the position's value, and DTZ where a capture or pawn
+// move is best, so those moves are tried as well. The best of them and
+// of the table is the position's result.
+static WDLScore
+probeWithCaptures(Position &pos, ProbeState &result, bool check_zeroing) {
+    WDLScore best       = WDL_LOSS;
+    MoveList moves      = pos.genMoves();
+    int      move_count = 0;
+
+    for (const Move &move : moves) {
+        if (!pos.isCapture(move) &&
+            (!check_zeroing ||
+             pos.board[move.from()].getType() != PT_PAWN)) {
+            continue;
+        }
+        move_count++;
+
+        Status status;
+        pos.makeMove(move, status);
+        WDLScore value = WDLScore(-probeWithCaptures(pos, result, false));
+        pos.unmakeMove(move, status);
+
+        if (result == PROBE_FAIL) {
+            return WDL_DRAW;
+        }
+        if (value > best) {
+            best = value;
+            if (value >= WDL_WIN) {
+                result = PROBE_ZEROING_BEST_MOVE;
+                return value;
+            }
+        }
+    }
+
+    // with every move tried the table isn't needed, and may be wrong: it
+    // knows nothing of en passant
+    bool     no_more_moves = move_count && move_count == moves.size();
+    WDLScore value         = best;
+    if (!no_more_moves) {
+        value = WDLScore(probeTable<TB_WDL>(pos, result));
+        if (result == PROBE_FAIL) {
+            return WDL_DRAW;
+        }
+    }
+
+    if (best >= value) {
+        result = best > WDL_DRAW || no_more_moves ? PROBE_ZEROING_BEST_MOVE
+                                                  : PROBE_OK;
+        return best;
+    }
+    result = PROBE_OK;
+    return value;
+}
+
+// DTZ has nothing for a capture or pawn move, whose dtz before it follows
+// from the result after it
+static int dtzBeforeZeroing(WDLScore wdl) {
+    return wdl == WDL_WIN            ? 1
+           : wdl == WDL_CURSED_WIN   ? 101
+           : wdl == WDL_BLESSED_LOSS ? -101
+           : wdl == WDL_LOSS         ? -1
+                                     : 0;
+}
+
+WDLScore Tablebases::probeWDL(Position &pos, ProbeState &result) {
+    result = PROBE_OK;
+    return probeWithCaptures(pos, result, false);
+}
+
+int Tablebases::probeDTZ(Position &pos, ProbeState &result) {
+    result       = PROBE_OK;
+    WDLScore wdl = probeWithCaptures(pos, result, true);
+
+    if (result == PROBE_FAIL || wdl == WDL_DRAW) {
+        return 0; // DTZ has no draws
+    }
+    if (result == PROBE_ZEROING_BEST_MOVE) {
+        return dtzBeforeZeroing(wdl);
+    }
+
+    int dtz = probeTable<TB_DTZ>(pos, result, wdl);
+    if (result == PROBE_FAIL) {
+        return 0;
+    }
+    if (result != PROBE_CHANGE_STM) {
+        bool cursed = wdl == WDL_BLESSED_LOSS || wdl == WDL_CURSED_WIN;
+        return (dtz + 100 * cursed) * signOf(wdl);
+    }
+
+    // the table is of the other side to move, so the best of the moves'
+    // dtz plus one, the quickest win or the slowest loss
+    int      min_dtz = 0xFFFF;
+    MoveList moves   = pos.genMoves();
+    for (const Move &move : moves) {
+        bool zeroing = pos.isCapture(move) ||
+                       pos.board[move.from()].getType() == PT_PAWN;
+
+        Status status;
+        pos.makeMove(move, status);
+
+        dtz = zeroing ? -dtzBeforeZeroing(probeWithCaptures(pos, result, false))
+                      : -probeDTZ(pos, result);
+
+        // a mate is always the quickest
+        if (dtz == 1 && pos.isCheck() && pos.genMoves().empty()) {
+            min_dtz = 1;
+        }
+        if (!zeroing) {
+            dtz += signOf(dtz);
+        }
+        if (dtz < min_dtz && signOf(dtz) == signOf(wdl)) {
+            min_dtz = dtz;
+        }
+
+        pos.unmakeMove(move, status);
+        if (result == PROBE_FAIL) {
+            return 0;
+        }
+    }
+
+    return min_dtz == 0xFFFF ? -1 : min_dtz; // no moves, mated
+}
+
+// how often the key was of a position before index of the game with the
+// same side to move since the last capture or pawn move
+static int occurrences(const std::vector<Position> &hist,
+                       int                          index,
+                       ui64                         key,
+                       int                          rule50) {
+    int found = 0;
+    for (int k = index - 4; k >= std::max(0, index - rule50); k -= 2) {
+        found += hist[k].key == key;
+    }
+    return found;
+}
+
+static bool rootProbeDTZ(const std::vector<Position> &hist,
+                         MoveList                    &moves,
+                         ui64                        &probes) {
+    Position   pos    = hist.back();
+    ProbeState result = PROBE_OK;
+    int        count  = int(hist.size());
+
+    // a repetition since the last capture or pawn move means the counter
+    // can't be trusted to reach a win in time
+    bool repeated = false;
+    for (int k = count - 1; k >= std::max(0, count - 1 - pos.rule50); k--) {
+        repeated |= occurrences(hist, k, hist[k].key, hist[k].rule50) > 0;
+    }
+
+    for (int k = 0; k < moves.size(); k++) {
+        Status status;
+        pos.makeMove(moves[k], status);
+
+        // the dtz of the move, from the root, a draw when it makes the
+        // third occurrence of a position
+        int dtz;
+        if (pos.rule50 == 0) {
+            WDLScore wdl = Tablebases::probeWDL(pos, result);
+            dtz          = dtzBeforeZeroing(WDLScore(-wdl));
+            probes++;
+        } else if (pos.rule50 >= 100 ||
+                   occurrences(hist, count, pos.key, pos.rule50) >= 2) {
+            dtz = 0;
+        } else {
+            dtz = -Tablebases::probeDTZ(pos, result);
+            dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
+            probes++;
+        }
+
+        if (pos.isCheck() && dtz == 2 && pos.genMoves().empty()) {
+            dtz = 1; // a mate
+        }
+
+        pos.unmakeMove(moves[k], status);
+        if (result == PROBE_FAIL) {
+            return false;
+        }
+
+        // the wins the 50 move rule can't spoil rank the same, the others
+        // by how close they are, and the losses likewise
+        int cnt50      = pos.rule50;
+        moves.score(k) = dtz > 0 ? (dtz + cnt50 <= 99 && !repeated
+                                        ? MAX_DTZ
+                                        : MAX_DTZ - (dtz + cnt50))
+                         : dtz < 0 ? (-dtz * 2 + cnt50 < 100
+                                          ? -MAX_DTZ
+                                          : -MAX_DTZ + (-dtz + cnt50))
+                                   : 0;
+    }
+
+    return true;
+}
+
+// with a DTZ table missing, the WDL ones still tell the wins and losses
+static bool rootProbeWDL(const std::vector<Position> &hist,
+                         MoveList                    &moves,
+                         ui64                        &probes) {
+    static const int WDL_TO_RANK[] = {
+        -MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
+
+    Position   pos    = hist.back();
+    ProbeState result = PROBE_OK;
+    int        count  = int(hist.size());
+
+    for (int k = 0; k < moves.size(); k++) {
+        Status status;
+        pos.makeMove(moves[k], status);
+
+        WDLScore wdl = WDL_DRAW;
+        if (pos.rule50 < 100 &&
+            occurrences(hist, count, pos.key, pos.rule50) < 2) {
+            wdl = WDLScore(-Tablebases::probeWDL(pos, result));
+            probes++;
+        }
+
+        pos.unmakeMove(moves[k], status);
+        if (result == PROBE_FAIL) {
+            return false;
+        }
+        moves.score(k) = WDL_TO_RANK[wdl + 2];
+    }
+
+    return true;
+}
+
+bool Tablebases::rankRootMoves(const std::vector<Position> &hist,
+                               int                          cardinality,
+                               MoveList                    &moves,
+                               bool                        &by_dtz,
+                               ui64                        &probes) {
+    const Position &root = hist.back();
+
+    moves.clear();
+    probes = 0;
+    if (int(bits::popcount(root.occupied())) > cardinality ||
+        root.castling_rights != CR_NONE) {
+        return false;
+    }
+
+    MoveList legal = root.genMoves();
+    if (legal.empty()) {
+        return false;
+    }
+
+    by_dtz = rootProbeDTZ(hist, legal, probes);
+    if (!by_dtz && !rootProbeWDL(hist, legal, probes)) {
+        return false;
+    }
+
+    int best = legal.score(0);
+    for (int k = 1; k < legal.size(); k++) {
+        best = std::max(best, legal.score(k));
+    }
+    for (int k = 0; k < legal.size(); k++) {
+        if (legal.score(k) == best) {
+            moves.push_back(legal[k], best);
+        }
+    }
+    return true;
+}
+
+int Tablebases::rootScore(int rank, bool rule50) {
+    if (rank >= MAX_DTZ - 100 || (rank > 0 && !rule50)) {
+        return TB_WIN;
+    }
+    if (rank <= -MAX_DTZ + 100 || (rank < 0 && !rule50)) {
+        return -TB_WIN;
+    }
+    return rank > 0 ? 2 : rank < 0 ? -2 : 0;
+}
+
+// the tables that map a group of squares to consecutive indices
+static void initIndexing() {
+    // the squares below the a1-h8 diagonal to 0 to 27
+    int code = 0;
+    for (int s = 0; s < 64; s++) {
+        if (offA1H8(s) < 0) {
+            map_b1h1h7[s] = code++;
+        }
+    }
+
+    // the a1-d1-d4 triangle to 0 to 9, the diagonal last
+    std::vector<int> diagonal;
+    code = 0;
+    for (int s = 0; s <= 27; s++) {
+        if (offA1H8(s) < 0 && (s & 7) <= 3) {
+            map_a1d1d4[s] = code++;
+        } else if (!offA1H8(s) && (s & 7) <= 3) {
+            diagonal.push_back(s);
+        }
+    }
+    for (int s : diagonal) {
+        map_a1d1d4[s] = code++;
+    }
+
+    // the 462 legal placements of two kings with the first in the
+    // triangle, and not the second above the diagonal when the first is on
+    // it, those with both on it last
+    std::vector<std::pair<int, int>> both_on_diagonal;
+    code = 0;
+    for (int idx = 0; idx < 10; idx++) {
+        for (int s1 = 0; s1 <= 27; s1++) {
+            if (map_a1d1d4[s1] != idx || (!idx && s1 != 1)) { // b1 is 0
+                continue;
+            }
+            for (int s2 = 0; s2 < 64; s2++) {
+                int distance = std::max(std::abs((s1 & 7) - (s2 & 7)),
+                                        std::abs((s1 >> 3) - (s2 >> 3)));
+                if (distance <= 1) {
+                    continue;
+                }
+                if (!offA1H8(s1) && offA1H8(s2) > 0) {
+                    continue;
+                }
+                if (!offA1H8(s1) && !offA1H8(s2)) {
+                    both_on_diagonal.emplace_back(idx, s2);
+                } else {
+                    map_kk[idx][s2] = code++;
+                }
+            }
+        }
+    }
+    for (const auto &[idx, s2] : both_on_diagonal) {
+        map_kk[idx][s2] = code++;
+    }
+
+    // pascal's triangle, the ways to pick k of n squares
+    binomial[0][0] = 1;
+    for (int n = 1; n < 64; n++) {
+        for (int k = 0; k < 6 && k <= n; k++) {
+            binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) +
+                             (k < n ? binomial[k][n - 1] : 0);
+        }
+    }
+
+    // the pawn squares a2-h7 to 47 down to 0, the leading pawn being the
+    // one with the highest, nearest the edge and then the lowest. Up to
+    // five leading pawns, indexed by file since the table is split by it
+    int available = 47;
+    for (int lead = 1; lead <= 5; lead++) {
+        for (int f = 0; f <= 3; f++) {
+            int idx = 0;
+            for (int r = 1; r <= 6; r++) {
+                int sq = 8 * r + f;
+                if (lead == 1) {
+                    map_pawns[sq]     = available--;
+                    map_pawns[sq ^ 7] = available--;
+                }
+                lead_pawn_idx[lead][sq] = idx;
+                idx += binomial[lead - 1][map_pawns[sq]];
+            }
+            lead_pawns_size[lead][f] = idx;
+        }
+    }
+}
+
+// adds the table of the pieces, white's from its king then black's, if its
+// WDL file is in one of the paths
+static void addTable(std::initializer_list<PieceType> pieces) {
+    const std::string PIECES = "PNBRQK";
+
+    std::string code;
+    int         counts[CL_COUNT][PT_COUNT] = {};
+    int         side                       = -1;
+    for (PieceType pt : pieces) {
+        side += pt == PT_KING;
+        if (pt == PT_KING && side) {
+            code += 'v';
+        }
+        code += PIECES[pt];
+        counts[side][pt]++;
+    }
+
+    if (findFile(code + ".rtbw").empty()) {
+        return;
+    }
+
+    int white = counts[CL_WHITE][PT_PAWN], black = counts[CL_BLACK][PT_PAWN];
+
+    TBTable<TB_WDL> &wdl = wdl_tables.emplace_back();
+    wdl.key              = materialHash(code, CL_WHITE);
+    wdl.key2             = materialHash(code, CL_BLACK);
+    wdl.piece_count      = int(pieces.size());
+    wdl.has_pawns        = white || black;
+    for (Color c : {CL_WHITE, CL_BLACK}) {
+        for (PieceType pt = PT_PAWN; pt < PT_KING; pt++) {
+            wdl.has_unique_pieces |= counts[c][pt] == 1;
+        }
+    }
+
+    // the side with the fewer pawns leads, it compresses better
+    bool white_leads  = !black || (white && black >= white);
+    wdl.pawn_count[0] = ui8(white_leads ? white : black);
+    wdl.pawn_count[1] = ui8(white_leads ? black : white);
+
+    TBTable<TB_DTZ> &dtz  = dtz_tables.emplace_back();
+    dtz.key               = wdl.key;
+    dtz.key2              = wdl.key2;
+    dtz.piece_count       = wdl.piece_count;
+    dtz.has_pawns         = wdl.has_pawns;
+    dtz.has_unique_pieces = wdl.has_unique_pieces;
+    dtz.pawn_count[0]     = wdl.pawn_count[0];
+    dtz.pawn_count[1]     = wdl.pawn_count[1];
+
+    tables[wdl.key]  = {&wdl, &dtz};
+    tables[wdl.key2] = {&wdl, &dtz};
+
+    Tablebases::max_cardinality =
+        std::max(Tablebases::max_cardinality, wdl.piece_count);
+}
+
+void Tablebases::init(const std::string &paths) {
+    tables.clear();
+    wdl_tables.clear();
+    dtz_tables.clear();
+    max_cardinality = 0;
+    tb_paths        = paths;
+
+    if (paths.empty() || paths == "<empty>") {
+        return;
+    }
+
+    initIndexing();
+
+    // every ending of up to 7 pieces, the stronger side's first
+    const PieceType K = PT_KING;
+    for (PieceType p1 = PT_PAWN; p1 < K; p1++) {
+        addTable({K, p1, K});
+
+        for (PieceType p2 = PT_PAWN; p2 <= p1; p2++) {
+            addTable({K, p1, p2, K});
+            addTable({K, p1, K, p2});
+
+            for (PieceType p3 = PT_PAWN; p3 < K; p3++) {
+                addTable({K, p1, p2, K, p3});
+            }
+
+            for (PieceType p3 = PT_PAWN; p3 <= p2; p3++) {
+                addTable({K, p1, p2, p3, K});
+
+                for (PieceType p4 = PT_PAWN; p4 <= p3; p4++) {
+                    addTable({K, p1, p2, p3, p4, K});
+
+                    for (PieceType p5 = PT_PAWN; p5 <= p4; p5++) {
+                        addTable({K, p1, p2, p3, p4, p5, K});
+                    }
+                    for (PieceType p5 = PT_PAWN; p5 < K; p5++) {
+                        addTable({K, p1, p2, p3, p4, K, p5});
+                    }
+                }
+
+                for (PieceType p4 = PT_PAWN; p4 < K; p4++) {
+                    addTable({K, p1, p2, p3, K, p4});
+
+                    for (PieceType p5 = PT_PAWN; p5 <= p4; p5++) {
+                        addTable({K, p1, p2, p3, K, p4, p5});
+                    }
+                }
+            }
+
+            for (PieceType p3 = PT_PAWN; p3 <= p1; p3++) {
+                for (PieceType p4 = PT_PAWN; p4 <= (p1 == p3 ? p2 : p3);
+                     p4++) {
+                    addTable({K, p1, p2, K, p3, p4});
+                }
+            }
+        }
+    }
+
+    std::cout << "info string found " << wdl_tables.size()
+              << " tablebases in " << paths << std::endl;
+}
@@ -0,0 +1,71 @@
+#ifndef KINGFISH_TABLEBASES_H
+#define KINGFISH_TABLEBASES_H
+
+#include <string>
+#include <vector>
+
+#include "../movegen.h"
+#include "../position.h"
+#include "../types.h"
+
+typedef i8 WDLScore;
+
+enum WDLScores { // for the side to move
+
+    WDL_LOSS         = -2,
+    WDL_BLESSED_LOSS = -1, // lost, but drawn by the 50 move rule
+    WDL_DRAW         = 0,
+    WDL_CURSED_WIN   = 1, // won, but drawn by the 50 move rule
+    WDL_WIN          = 2
+
+};
+
+typedef i8 ProbeState;
+
+enum ProbeStates {
+
+    PROBE_FAIL              = 0,  // no table, or the file couldn't be read
+    PROBE_OK                = 1,
+    PROBE_CHANGE_STM        = -1, // the DTZ table is of the other side
+    PROBE_ZEROING_BEST_MOVE = 2   // the best move is a capture or pawn move
+
+};
+
+// Syzygy tablebases: the WDL tables probed in the search and the DTZ tables
+// at the root. The files are only found by init, and are memory mapped read
+// only when first probed, so engines on the same host share one copy of
+// them in the page cache.
+namespace Tablebases {
+
+extern int max_cardinality; // the most pieces of any table found
+
+// finds the tables in the directories of paths, separated by ':'. Not
+// thread safe, never called during a search
+void init(const std::string &paths);
+
+// the result of the position and of the best move from it, the ones that
+// fail leave result at PROBE_FAIL. probeDTZ is in plies to the next
+// capture or pawn move, negative when lost and beyond 100 when the 50 move
+// rule draws it
+WDLScore probeWDL(Position &pos, ProbeState &result);
+int      probeDTZ(Position &pos, ProbeState &result);
+
+// ranks the legal moves of the game's last position with the DTZ tables,
+// or the WDL ones when a DTZ table is missing, and leaves moves with the
+// best ranked only, the rank as their score. probes counts the tables
+// probed for it. False, with moves empty, when the root has more than
+// cardinality pieces or a probe failed
+bool rankRootMoves(const std::vector<Position> &hist,
+                   int                          cardinality,
+                   MoveList                    &moves,
+                   bool                        &by_dtz,
+                   ui64                        &probes);
+
+// the score of a root ranked rank: TB_WIN, or -TB_WIN, for the wins and
+// losses in reach of the 50 move rule, the others just off a draw when
+// rule50 counts, like the search's
+int rootScore(int rank, bool rule50);
+
+} // namespace Tablebases
+
+#endif // !KINGFISH_TABLEBASES_H
@@ -0,0 +1,314 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "../options.h"
+#include "../uci.h"
+
+static SearchParams readSearchParams() {
+    SearchParams params;
+
+    params.lmr           = options.getBoolValue("LMR");
+    params.lmr_base      = options.getIntValue("LMR Base");
+    params.lmr_divisor   = options.getIntValue("LMR Divisor");
+    params.lmr_min_depth = options.getIntValue("LMR Min Depth");
+    params.lmr_min_moves = options.getIntValue("LMR Min Moves");
+
+    params.rfp        = options.getBoolValue("RFP");
+    params.rfp_depth  = options.getIntValue("RFP Depth");
+    params.rfp_margin = options.getIntValue("RFP Margin");
+
+    params.futility        = options.getBoolValue("Futility");
+    params.futility_depth  = options.getIntValue("Futility Depth");
+    params.futility_margin = options.getIntValue("Futility Margin");
+
+    params.lmp       = options.getBoolValue("LMP");
+    params.lmp_depth = options.getIntValue("LMP Depth");
+    params.lmp_base  = options.getIntValue("LMP Base");
+
+    params.see_pruning      = options.getBoolValue("SEE Pruning");
+    params.see_depth        = options.getIntValue("SEE Depth");
+    params.see_quiet_margin = options.getIntValue("SEE Quiet Margin");
+
+    params.check_extensions = options.getBoolValue("Check Extensions");
+
+    // past what the tables found have, the most pieces they do have are
+    // probed at any depth
+    params.tb_cardinality = options.getIntValue("SyzygyProbeLimit");
+    params.tb_probe_depth = options.getIntValue("SyzygyProbeDepth");
+    params.tb_rule50      = options.getBoolValue("Syzygy50MoveRule");
+    if (params.tb_cardinality > Tablebases::max_cardinality) {
+        params.tb_cardinality = Tablebases::max_cardinality;
+        params.tb_probe_depth = 0;
+    }
+
+    return params;
+}
+
+ThreadPool::ThreadPool()
+    : tt(options.getIntValue("Hash")) {
+    this->setThreads(1);
+}
+
+void ThreadPool::setThreads(int count) {
+    this->searchers.clear();
+    for (int id = 0; id < count; id++) {
+        this->searchers.push_back(
+            std::make_unique<Searcher>(
+                this->tt, this->network, this->stop_search, id));
+    }
+}
+
+void ThreadPool::resizeHash(std::size_t mb) {
+    this->tt.resize(mb, this->searchers.size());
+}
+
+void ThreadPool::clearHash() {
+    this->tt.clear(this->searchers.size());
+}
+
+void ThreadPool::clearHistory() {
+    for (const auto &searcher : this->searchers) {
+        searcher->history.clear();
+    }
+}
+
+void ThreadPool::loadNetwork() {
+    std::string path = options.getOptionValue("EvalFile");
+    this->clearEvals();
+
+    if (this->network.load(path)) {
+        std::cout << "info string loaded network " << path << " using "
+                  << simdName() << std::endl;
+    } else {
+        std::cout << "info string no network in " << path
+                  << ", using the psqt eval" << std::endl;
+    }
+}
+
+void ThreadPool::clearEvals() {
+    // the hash table keeps static evals as well, of whichever eval stored
+    // them, so it goes with the caches
+    for (const auto &searcher : this->searchers) {
+        searcher->eval_cache.clear();
+    }
+    this->clearHash();
+}
+
+ui64 ThreadPool::nodesSearched() const {
+    ui64 nodes = 0;
+    for (const auto &searcher : this->searchers) {
+        nodes += searcher->nodes_searched.load(std::memory_order_relaxed);
+    }
+    return nodes;
+}
+
+ui64 ThreadPool::tbHits() const {
+    ui64 hits = 0;
+    for (const auto &searcher : this->searchers) {
+        hits += searcher->tb_hits.load(std::memory_order_relaxed);
+    }
+    return hits;
+}
+
+void ThreadPool::searchTimed(std::vector<Position> &hist, int ms_time) {
+    this->search(hist, ms_time);
+}
+
+void ThreadPool::searchInfinite(std::vector<Position> &hist) {
+    this->search(hist, -1);
+}
+
+void ThreadPool::search(std::vector<Position> &hist, int ms_time) {
+    // the main thread runs the iterative deepening and reports, the helpers
+    // search the same root on their own until it tells them to stop
+    this->tt.newSearch();
+    this->stop_search = false;
+
+    if (this->network.getPath() != options.getOptionValue("EvalFile")) {
+        this->loadNetwork();
+    }
+    bool use_nnue =
+        options.getBoolValue("Use NNUE") && this->network.isLoaded();
+
+    // the cached evals are of the other eval
+    if (this->evals_nnue != use_nnue) {
+        this->clearEvals();
+        this->evals_nnue = use_nnue;
+    }
+
+    SearchParams params = readSearchParams();
+
+    // in the tables the root moves are ranked by them, and only the best
+    // searched. With DTZ they also keep a win on its way, so the search
+    // needs no more probes, nor does it with nothing to win
+    MoveList root_moves;
+    bool     by_dtz     = false;
+    ui64     root_hits  = 0;
+    bool     root_in_tb = Tablebases::rankRootMoves(
+        hist, params.tb_cardinality, root_moves, by_dtz, root_hits);
+    if (root_in_tb && (by_dtz || root_moves.score(0) <= 0)) {
+        params.tb_cardinality = 0;
+    }
+    int tb_score = root_in_tb ? Tablebases::rootScore(root_moves.score(0),
+                                                      params.tb_rule50)
+                              : 0;
+
+    for (const auto &searcher : this->searchers) {
+        searcher->nodes_searched     = 0;
+        searcher->tb_hits            = 0;
+        searcher->root_moves         = root_moves;
+        searcher->root_move          = NULLMOVE;
+        searcher->root_score         = 0;
+        searcher->completed_depth    = 0;
+        searcher->cutoffs            = 0;
+        searcher->first_move_cutoffs = 0;
+        searcher->pawns.probes       = 0;
+        searcher->pawns.hits         = 0;
+        searcher->eval_cache.probes  = 0;
+        searcher->eval_cache.hits    = 0;
+        searcher->use_pvs            = options.getBoolValue("Use PVS");
+        searcher->use_nnue           = use_nnue;
+        searcher->setParams(params);
+        searcher->setRoot(hist);
+    }
+    this->searchers[0]->tb_hits = root_hits;
+
+    std::vector<std::thread> helpers;
+    for (std::size_t t = 1; t < this->searchers.size(); t++) {
+        helpers.emplace_back(&Searcher::searchHelper,
+                             this->searchers[t].get());
+    }
+
+    Searcher &main       = *this->searchers[0];
+    auto      start_time = Clock::now();
+    Move      best_move  = NULLMOVE;
+
+    for (int depth = 1; depth < MAX_PLY && !this->stop_search; depth++) {
+        for (auto gen = main.search(depth); gen.next();) {
+            if (this->stop_search) {
+                break;
+            }
+
+            Bound bound;
+            int   score;
+            Move  move;
+            std::tie(bound, score, move) = gen.value();
+
+            best_move       = move;
+            main.root_score = score;
+
+            // the tables know the result better than a search that no
+            // longer probes them, unless it found a mate
+            if (root_in_tb && std::abs(score) < MATE_LOWER) {
+                score = tb_score;
+                bound = BOUND_EXACT;
+            }
+            this->printPvInfo(main.principalVariation(depth),
+                              depth,
+                              score,
+                              bound,
+                              start_time);
+
+            if (ms_time >= 0 && deltaMs(Clock::now(), start_time) > ms_time) {
+                this->stop_search = true;
+                break;
+            }
+        }
+
+        if (!this->stop_search) {
+            main.completed_depth = depth;
+        }
+    }
+
+    // an infinite search that ran out of depths still waits for stop
+    while (ms_time < 0 && !this->stop_search) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    this->stop_search = true;
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+
+    // a helper that finished a deeper iteration than the main thread has
+    // the better move
+    int best_depth = main.completed_depth;
+    for (const auto &searcher : this->searchers) {
+        if (searcher->completed_depth > best_depth &&
+            searcher->root_move != NULLMOVE) {
+            best_depth = searcher->completed_depth;
+            best_move  = searcher->root_move;
+        }
+    }
+
+    // how often the first move searched was the one that cut off, the
+    // better the move ordering the closer to 100%
+    ui64 cutoffs = 0, first_move_cutoffs = 0;
+    ui64 pawn_probes = 0, pawn_hits = 0, eval_probes = 0, eval_hits = 0;
+    for (const auto &searcher : this->searchers) {
+        cutoffs += searcher->cutoffs;
+        first_move_cutoffs += searcher->first_move_cutoffs;
+        pawn_probes += searcher->pawns.probes;
+        pawn_hits += searcher->pawns.hits;
+        eval_probes += searcher->eval_cache.probes;
+        eval_hits += searcher->eval_cache.hits;
+    }
+    if (cutoffs > 0) {
+        std::cout << "info string first move cutoffs "
+                  << first_move_cutoffs * 1000 / cutoffs / 10.0 << "% of "
+                  << cutoffs << std::endl;
+    }
+    if (pawn_probes > 0) {
+        std::cout << "info string pawn hash hits "
+                  << pawn_hits * 1000 / pawn_probes / 10.0 << "% of "
+                  << pawn_probes << std::endl;
+    }
+    if (eval_probes > 0) {
+        std::cout << "info string eval cache hits "
+                  << eval_hits * 1000 / eval_probes / 10.0 << "% of "
+                  << eval_probes << std::endl;
+    }
+
+    std::cout << "bestmove "
+              << (best_move != NULLMOVE ? renderMove(best_move) : "(none)")
+              << std::endl;
+}
+
+void ThreadPool::printPvInfo(const std::vector<Move> &pv,
+                             int                      depth,
+                             int                      score,
+                             Bound                    bound,
+                             TimePoint                start_time) {
+    std::string pv_str;
+    for (const Move &move : pv) {
+        if (!pv_str.empty()) {
+            pv_str += ' ';
+        }
+        pv_str += renderMove(move);
+    }
+
+    int  time  = std::max<int>(1, deltaMs(Clock::now(), start_time));
+    ui64 nodes = this->nodesSearched();
+
+    // a search that failed low or high only bounds the score
+    const char *bound_str = bound == BOUND_LOWER   ? " lowerbound"
+                            : bound == BOUND_UPPER ? " upperbound"
+                                                   : "";
+
+    std::cout << "info depth " << depth << " score cp " << score << bound_str
+              << " nodes " << nodes << " nps " << (nodes * 1000) / time
+              << " hashfull " << this->tt.getPermillFull() << " tbhits "
+              << this->tbHits() << " time " << time << " pv " << pv_str
+              << std::endl;
+}
+
+void ThreadPool::stopSearch() {
+    this->stop_search = true;
+}
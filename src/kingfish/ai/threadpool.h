@@ -0,0 +1,48 @@
+#ifndef KINGFISH_THREADPOOL_H
+#define KINGFISH_THREADPOOL_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "../clock.h"
+#include "../move.h"
+#include "../position.h"
+#include "nnue.h"
+#include "searcher.h"
+#include "transpositiontable.h"
+
+class ThreadPool { // the searchers of a lazy smp search and what they share
+  public:
+    ThreadPool();
+
+    TranspositionTable                     tt;
+    Network                                network; // read from EvalFile
+    std::atomic<bool>                      stop_search = false;
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    // whether the evals in the caches and the hash are the network's
+    bool                                   evals_nnue = false;
+
+    void setThreads(int count);
+    void resizeHash(std::size_t mb);
+    void clearHash();
+    void clearHistory();
+    void loadNetwork();
+    ui64 nodesSearched() const;
+    ui64 tbHits() const;
+
+    void searchTimed(std::vector<Position> &hist, int ms_time);
+    void searchInfinite(std::vector<Position> &hist);
+    void stopSearch();
+
+  private:
+    void clearEvals();
+    void search(std::vector<Position> &hist, int ms_time);
+    void printPvInfo(const std::vector<Move> &pv,
+                     int                      depth,
+                     int                      score,
+                     Bound                    bound,
+                     TimePoint                start_time);
+};
+
+#endif // !KINGFISH_THREADPOOL_H
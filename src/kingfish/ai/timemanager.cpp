@@ -26,7 +26,7 @@ int getSearchTime(const std::vector<std::string> &args,
     int moves_left =
         std::max(1, 50 - (int)hist.size() / 2); // don't go negative
 
-    if (hist.size() % 2 == 1) {
+    if (hist.back().turn == CL_WHITE) {
         remaining_time = wtime + winc * moves_left;
         if (remaining_time <=
             10000) { // less than or equal to 10 seconds remaining
@@ -0,0 +1,154 @@
+#include "transpositiontable.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+static void *allocLargePages(std::size_t bytes) {
+    constexpr std::size_t HUGE_PAGE = 2 * MB;
+
+    bytes     = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    void *mem = std::aligned_alloc(HUGE_PAGE, bytes);
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // transparent huge pages, fewer tlb misses on the random accesses
+    if (mem) {
+        madvise(mem, bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    return mem;
+}
+
+TranspositionTable::TranspositionTable(std::size_t mb, int threads) {
+    this->resize(mb, threads);
+}
+
+void TranspositionTable::resize(std::size_t mb, int threads) {
+    std::size_t count = std::bit_floor(mb * MB / sizeof(TTCluster));
+
+    this->clusters.reset(); // free the old table before taking the new one
+    this->clusters.reset(static_cast<TTCluster *>(
+        allocLargePages(count * sizeof(TTCluster))));
+    if (!this->clusters) {
+        std::cerr << "Failed to allocate " << mb << "MB for the hash table"
+                  << std::endl;
+        exit(1);
+    }
+
+    this->mask = count - 1;
+    this->clear(threads);
+}
+
+bool TranspositionTable::probe(ui64 key, TTEntry &entry) const {
+    const TTCluster &cluster = this->clusters[key & this->mask];
+    ui32             key32   = key >> 32;
+
+    for (const TTEntry &e : cluster.entries) {
+        TTEntry copy = e; // read once, other threads may be writing it
+        if (copy.bound() != BOUND_NONE && copy.matches(key32)) {
+            entry = copy;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(
+    ui64 key, int depth, int score, Bound bound, Move move, int eval) {
+    TTCluster &cluster = this->clusters[key & this->mask];
+    ui32       key32   = key >> 32;
+
+    // overwrite the entry for this position if there is one, otherwise the
+    // one that is shallowest, counting each search it is old as 8 plies
+    TTEntry *replace = &cluster.entries[0];
+    for (TTEntry &e : cluster.entries) {
+        if (e.matches(key32) || e.bound() == BOUND_NONE) {
+            replace = &e;
+            break;
+        }
+
+        int age      = (this->generation - e.generation()) & 63;
+        int best_age = (this->generation - replace->generation()) & 63;
+        if (e.depth - 8 * age < replace->depth - 8 * best_age) {
+            replace = &e;
+        }
+    }
+
+    if (replace->matches(key32)) {
+        if (move == NULLMOVE) {
+            move = replace->move;
+        }
+
+        // a shallow result of this search, from qsearch or a tablebase
+        // probe, mustn't wipe out a deeper one, only its move is newer
+        int age = (this->generation - replace->generation()) & 63;
+        if (bound != BOUND_EXACT && depth + 4 <= replace->depth && !age) {
+            depth = replace->depth;
+            score = replace->score;
+            bound = replace->bound();
+            eval  = replace->eval;
+        }
+    }
+
+    TTEntry entry;
+    entry.score     = score;
+    entry.move      = move;
+    entry.eval      = i16(std::clamp(eval, -INT16_MAX, INT16_MAX));
+    entry.depth     = ui8(depth);
+    entry.gen_bound = ui8(this->generation << 2 | bound);
+    entry.key32     = key32 ^ entry.data32();
+
+    *replace = entry;
+}
+
+void TranspositionTable::newSearch() {
+    this->generation = (this->generation + 1) & 63;
+}
+
+void TranspositionTable::clear(int threads) {
+    // each thread zeroes a slice, a table of several GB takes seconds for
+    // one thread, and the pages are touched by the threads that use them
+    std::size_t count = this->mask + 1;
+    std::size_t slice = (count + threads - 1) / threads;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        std::size_t begin = std::min(count, t * slice);
+        std::size_t end   = std::min(count, begin + slice);
+
+        workers.emplace_back([this, begin, end]() {
+            std::memset(static_cast<void *>(this->clusters.get() + begin),
+                        0,
+                        (end - begin) * sizeof(TTCluster));
+        });
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    this->generation = 0;
+}
+
+int TranspositionTable::getPermillFull() const {
+    // sampled from the first clusters, counting entries of this search
+    int used = 0;
+    for (int c = 0; c < 1000 / CLUSTER_SIZE; c++) {
+        for (const TTEntry &e : this->clusters[c].entries) {
+            used += e.bound() != BOUND_NONE &&
+                    e.generation() == this->generation;
+        }
+    }
+
+    return used;
+}
@@ -0,0 +1,81 @@
+#ifndef KINGFISH_TRANSPOSITIONTABLE_H
+#define KINGFISH_TRANSPOSITIONTABLE_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+#include "../move.h"
+#include "../types.h"
+
+constexpr std::size_t MB = 1024 * 1024;
+
+typedef ui8 Bound;
+
+enum Bounds {
+
+    BOUND_NONE,
+    BOUND_UPPER, // the score failed low, the real one is at most this
+    BOUND_LOWER, // the score failed high, the real one is at least this
+    BOUND_EXACT = BOUND_UPPER | BOUND_LOWER
+
+};
+
+struct TTEntry { // 16 bytes
+    // the high half of the zobrist key (the low half is the index) xor'ed
+    // with the rest of the entry, so an entry torn by two threads writing
+    // it at once no longer matches instead of being trusted
+    ui32 key32;
+    i32  score;
+    Move move;
+    i16  eval; // the static eval, a hit needn't evaluate the position again
+    ui8  depth;
+    ui8  gen_bound; // generation << 2 | bound
+
+    inline Bound bound() const { return this->gen_bound & 3; }
+    inline ui8   generation() const { return this->gen_bound >> 2; }
+    inline ui32  data32() const {
+        return ui32(this->score) ^ (this->move.data | this->depth << 16 |
+                                    this->gen_bound << 24) ^
+               ui32(ui16(this->eval)) << 8;
+    }
+    inline bool matches(ui32 key) const {
+        return (this->key32 ^ this->data32()) == key;
+    }
+};
+
+const int CLUSTER_SIZE = 4;
+
+struct alignas(64) TTCluster { // one cache line
+    TTEntry entries[CLUSTER_SIZE];
+};
+
+static_assert(sizeof(TTCluster) == 64);
+
+class TranspositionTable {
+  public:
+    explicit TranspositionTable(std::size_t mb, int threads = 1);
+
+    void resize(std::size_t mb, int threads = 1);
+
+    bool probe(ui64 key, TTEntry &entry) const;
+    void store(
+        ui64 key, int depth, int score, Bound bound, Move move, int eval);
+
+    inline void prefetch(ui64 key) const {
+        __builtin_prefetch(&this->clusters[key & this->mask]);
+    }
+
+    void newSearch();
+    void clear(int threads = 1);
+    int  getPermillFull() const;
+
+  private:
+    // allocated on 2MB boundaries so the kernel can back it with huge pages
+    std::unique_ptr<TTCluster[], decltype(&std::free)> clusters{nullptr,
+                                                                &std::free};
+    std::size_t                                        mask = 0;
+    ui8                          generation = 0; // 6 bits, bumped per search
+};
+
+#endif // !KINGFISH_TRANSPOSITIONTABLE_H
@@ -1,8 +1,77 @@
 #include "bitboard.h"
 
+#include <cassert>
 #include <iostream>
 
+#include "bits.h"
+
 namespace BBS {
+Bitboard pawn_attacks[2][64];
+Bitboard knight_attacks[64];
+Bitboard king_attacks[64];
+
+Bitboard between_bb[64][64];
+Bitboard line_bb[64][64];
+
+Magic bishop_magics[64];
+Magic rook_magics[64];
+
+// one slot per blocker subset of every mask, 2^popcount(mask) per square
+static Bitboard bishop_table[5248];
+static Bitboard rook_table[102400];
+
+// clang-format off
+static constexpr Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+    C64(0x0420220228022C80), C64(0x200208010C108000), C64(0x1004010411040040),
+    C64(0x12A4040292002440), C64(0x0804042082000850), C64(0x0802020220010440),
+    C64(0x800401048260201A), C64(0x0041010800828800), C64(0x4040641488080104),
+    C64(0x20002004016E0020), C64(0x0C2C223A12420042), C64(0x0100024081020220),
+    C64(0x0383211041025080), C64(0x08C0030420160600), C64(0x0C1000510808C00A),
+    C64(0x40501A0084140280), C64(0x40280040112C0088), C64(0x4020040908110050),
+    C64(0x1028001008801412), C64(0x0104220202020000), C64(0x800A000400940010),
+    C64(0x0401000200512410), C64(0x1082012100900408), C64(0x0101402208440C00),
+    C64(0x00482104C01C1111), C64(0x0310105008017101), C64(0x0022010108080020),
+    C64(0x02300400104010A0), C64(0x1401010011444000), C64(0x1001020000405020),
+    C64(0x00010A0804480411), C64(0x0419220010404400), C64(0x0010020A00200820),
+    C64(0xA008280909040104), C64(0x0210209010080020), C64(0x3006110800040040),
+    C64(0x0800820200440090), C64(0x0008100421810080), C64(0x0028060093264800),
+    C64(0x0A08004088810080), C64(0x3611100290442000), C64(0x0241081282001001),
+    C64(0x11081108010D0800), C64(0x002A102014420800), C64(0x480002600A004500),
+    C64(0x8001010102000100), C64(0x2008080810410883), C64(0x0002080901101022),
+    C64(0x2800942420444080), C64(0x2000840108024000), C64(0x0000804844100040),
+    C64(0x1444120020884540), C64(0x0004001002020C00), C64(0x041041C801010049),
+    C64(0x0060045000850810), C64(0x1003240C14820208), C64(0x3010104A10100800),
+    C64(0x0280020101580200), C64(0x1000000101081600), C64(0x0644009800420200),
+    C64(0x0050040008102402), C64(0x00000004601C8106), C64(0x00088530040812A0),
+    C64(0x800218010102020C),
+};
+
+static constexpr Bitboard ROOK_MAGIC_NUMBERS[64] = {
+    C64(0x0280132180004001), C64(0x0140001000200040), C64(0x0880200010000880),
+    C64(0x2080080005801000), C64(0x0200041020080200), C64(0x0200041041084200),
+    C64(0x0400080081124410), C64(0x2180042100004080), C64(0x8000800099644000),
+    C64(0x0802003040820100), C64(0x0105801001862000), C64(0x0101002008100100),
+    C64(0x1000800400080080), C64(0x0804800200040080), C64(0x2001800200800900),
+    C64(0x00160004088204C1), C64(0x228000C001402000), C64(0x8510004000200050),
+    C64(0x3001848020029000), C64(0x0280808010000801), C64(0x0109010010040800),
+    C64(0x8000808004000200), C64(0x8000040081021028), C64(0x40040A0009004884),
+    C64(0x80C0004280008035), C64(0x0010004040002000), C64(0x1101200500410070),
+    C64(0x8410100080080080), C64(0x000C080080800400), C64(0x4012008080040002),
+    C64(0x4000040101000200), C64(0x0061010200008044), C64(0x0080804010800020),
+    C64(0x3000201008400040), C64(0x4112008012002444), C64(0x0848000880801000),
+    C64(0x00A8008008800400), C64(0x200200280A00500C), C64(0x080A221024004801),
+    C64(0xC400008042000104), C64(0x8000400080028022), C64(0x0220008040018020),
+    C64(0x4000200011010040), C64(0x10060040210A0010), C64(0x40820020904A0004),
+    C64(0x0030040002008080), C64(0x0200020801840010), C64(0x0084C04100820004),
+    C64(0x4802010080C2A600), C64(0x0000400080201880), C64(0x2040801000200080),
+    C64(0x0180200842001200), C64(0x0013510008000500), C64(0x0182000C00808A80),
+    C64(0x1000524821302400), C64(0x3800040108488200), C64(0x104A004810210082),
+    C64(0x0004210010420082), C64(0xC424110008200241), C64(0x90101000A0088501),
+    C64(0x0182000420100802), C64(0x4822001001080402), C64(0x05D0080090012204),
+    C64(0x2008140089042846),
+};
+// clang-format on
+
 void printBitboard(Bitboard bitboard) {
     std::cout << std::endl;
 
@@ -135,19 +204,7 @@ Bitboard maskRookAttacks(Square square) {
     return attacks;
 }
 
-Bitboard pawnAttacks(Color side, Square square) {
-    return pawn_attacks[side][square];
-}
-
-Bitboard knightAttacks(Square square) {
-    return knight_attacks[square];
-}
-
-Bitboard kingAttacks(Square square) {
-    return king_attacks[square];
-}
-
-Bitboard bishopAttacks(Square square, Bitboard block) {
+Bitboard bishopAttacksOnTheFly(Square square, Bitboard block) {
     Bitboard attacks = 0;
 
     int f, r;
@@ -182,7 +239,7 @@ Bitboard bishopAttacks(Square square, Bitboard block) {
     return attacks;
 }
 
-Bitboard rookAttacks(Square square, Bitboard block) {
+Bitboard rookAttacksOnTheFly(Square square, Bitboard block) {
     Bitboard attacks = 0ULL;
 
     int f, r;
@@ -217,10 +274,6 @@ Bitboard rookAttacks(Square square, Bitboard block) {
     return attacks;
 }
 
-Bitboard queenAttacks(Square square, Bitboard block) {
-    return bishopAttacks(square, block) | rookAttacks(square, block);
-}
-
 void initLeaperAttacks() {
     for (Square square = SQ_A8; square < SQ_COUNT; square++) {
         pawn_attacks[CL_WHITE][square] = maskPawnAttacks(CL_WHITE, square);
@@ -229,4 +282,94 @@ void initLeaperAttacks() {
         king_attacks[square]           = maskKingAttacks(square);
     }
 }
-} // namespace BBS
\ No newline at end of file
+
+static void initMagics(Magic           *magics,
+                       Bitboard        *table,
+                       const Bitboard  *magic_numbers,
+                       Bitboard (*mask)(Square),
+                       Bitboard (*on_the_fly)(Square, Bitboard)) {
+    Bitboard *attacks = table;
+
+    for (Square square = SQ_A8; square < SQ_COUNT; square++) {
+        Magic &m  = magics[square];
+        m.mask    = mask(square);
+        m.magic   = magic_numbers[square];
+        m.shift   = 64 - bits::popcount(m.mask);
+        m.attacks = attacks;
+
+        // walk every subset of the mask (carry-rippler)
+        Bitboard block = 0;
+        do {
+            m.attacks[m.index(block)] = on_the_fly(square, block);
+            block                     = (block - m.mask) & m.mask;
+        } while (block);
+
+        attacks += 1ULL << bits::popcount(m.mask);
+    }
+}
+
+void initSliderAttacks() {
+    initMagics(bishop_magics,
+               bishop_table,
+               BISHOP_MAGIC_NUMBERS,
+               maskBishopAttacks,
+               bishopAttacksOnTheFly);
+    initMagics(rook_magics,
+               rook_table,
+               ROOK_MAGIC_NUMBERS,
+               maskRookAttacks,
+               rookAttacksOnTheFly);
+
+    assert(checkSliderAttacks());
+}
+
+bool checkSliderAttacks() {
+    // compares the tables with the ray walking loops for every blocker
+    // subset of the masks, with and without pieces on the board edges
+    constexpr Bitboard edges = 0xFF818181818181FFULL;
+
+    for (Square square = SQ_A8; square < SQ_COUNT; square++) {
+        for (bool rook : {false, true}) {
+            Bitboard mask  = rook ? rook_magics[square].mask
+                                  : bishop_magics[square].mask;
+            Bitboard block = 0;
+            do {
+                for (Bitboard extra : {Bitboard(0), edges & ~mask}) {
+                    Bitboard full = block | extra;
+                    Bitboard got  = rook ? rookAttacks(square, full)
+                                         : bishopAttacks(square, full);
+                    Bitboard want = rook ? rookAttacksOnTheFly(square, full)
+                                         : bishopAttacksOnTheFly(square, full);
+                    if (got != want) {
+                        std::cerr << "slider attacks mismatch on square "
+                                  << (int)square << std::endl;
+                        return false;
+                    }
+                }
+                block = (block - mask) & mask;
+            } while (block);
+        }
+    }
+
+    return true;
+}
+
+void initLines() {
+    for (Square a = SQ_A8; a < SQ_COUNT; a++) {
+        for (Square b = SQ_A8; b < SQ_COUNT; b++) {
+            Bitboard ends = (1ULL << a) | (1ULL << b);
+
+            if (a != b && (rookAttacks(a, 0) & (1ULL << b))) {
+                line_bb[a][b] = (rookAttacks(a, 0) & rookAttacks(b, 0)) | ends;
+                between_bb[a][b] =
+                    rookAttacks(a, 1ULL << b) & rookAttacks(b, 1ULL << a);
+            } else if (a != b && (bishopAttacks(a, 0) & (1ULL << b))) {
+                line_bb[a][b] =
+                    (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | ends;
+                between_bb[a][b] =
+                    bishopAttacks(a, 1ULL << b) & bishopAttacks(b, 1ULL << a);
+            }
+        }
+    }
+}
+} // namespace BBS
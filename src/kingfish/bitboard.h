@@ -3,13 +3,16 @@
 
 #include <iostream>
 
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
 #include "types.h"
 
 // bit manipulation macros
-#define get_bit(bitboard, index) (bitboard & (1ULL << index))
-#define set_bit(bitboard, index) (bitboard |= (1ULL << index))
-#define pop_bit(bitboard, index) \
-    (get_bit(bitboard, index) ? bitboard ^= (1ULL << index) : 0)
+#define get_bit(bitboard, index) ((bitboard) & (1ULL << (index)))
+#define set_bit(bitboard, index) ((bitboard) |= (1ULL << (index)))
+#define pop_bit(bitboard, index) ((bitboard) &= ~(1ULL << (index)))
 
 
 namespace BBS {
@@ -20,9 +23,36 @@ constexpr Bitboard not_h_file  = 9187201950435737471ULL;
 constexpr Bitboard not_hg_file = 4557430888798830399ULL;
 constexpr Bitboard not_ab_file = 18229723555195321596ULL;
 
-static Bitboard pawn_attacks[2][64]; // pawn attacks array [side][square]
-static Bitboard knight_attacks[64];
-static Bitboard king_attacks[64];
+constexpr Bitboard rank_8 = 0x00000000000000FFULL;
+constexpr Bitboard rank_7 = 0x000000000000FF00ULL;
+constexpr Bitboard rank_2 = 0x00FF000000000000ULL;
+constexpr Bitboard rank_1 = 0xFF00000000000000ULL;
+
+extern Bitboard pawn_attacks[2][64]; // pawn attacks array [side][square]
+extern Bitboard knight_attacks[64];
+extern Bitboard king_attacks[64];
+
+// slider attacks for one square, indexed by the blockers on its mask
+struct Magic {
+    Bitboard  mask;
+    Bitboard  magic;
+    Bitboard *attacks;
+    int       shift;
+
+    inline unsigned index(Bitboard block) const {
+#ifdef USE_PEXT
+        return static_cast<unsigned>(_pext_u64(block, mask));
+#else
+        return static_cast<unsigned>(((block & mask) * magic) >> shift);
+#endif
+    }
+};
+
+extern Magic bishop_magics[64];
+extern Magic rook_magics[64];
+
+extern Bitboard between_bb[64][64]; // squares strictly between two squares
+extern Bitboard line_bb[64][64];    // the whole line through two squares
 
 Bitboard maskPawnAttacks(Color side, Square square);
 Bitboard maskKnightAttacks(Square square);
@@ -30,15 +60,48 @@ Bitboard maskKingAttacks(Square square);
 Bitboard maskBishopAttacks(Square square);
 Bitboard maskRookAttacks(Square square);
 
-Bitboard pawnAttacks(Color side, Square square);
-Bitboard knightAttacks(Square square);
-Bitboard kingAttacks(Square square);
+inline Bitboard pawnAttacks(Color side, Square square) {
+    return pawn_attacks[side][square];
+}
 
-Bitboard bishopAttacks(Square square, Bitboard block);
-Bitboard rookAttacks(Square square, Bitboard block);
-Bitboard queenAttacks(Square square, Bitboard block);
+inline Bitboard knightAttacks(Square square) {
+    return knight_attacks[square];
+}
+
+inline Bitboard kingAttacks(Square square) {
+    return king_attacks[square];
+}
+
+inline Bitboard betweenBB(Square a, Square b) {
+    return between_bb[a][b];
+}
+
+inline Bitboard lineBB(Square a, Square b) {
+    return line_bb[a][b];
+}
+
+Bitboard bishopAttacksOnTheFly(Square square, Bitboard block);
+Bitboard rookAttacksOnTheFly(Square square, Bitboard block);
+
+inline Bitboard bishopAttacks(Square square, Bitboard block) {
+    const Magic &m = bishop_magics[square];
+    return m.attacks[m.index(block)];
+}
+
+inline Bitboard rookAttacks(Square square, Bitboard block) {
+    const Magic &m = rook_magics[square];
+    return m.attacks[m.index(block)];
+}
+
+inline Bitboard queenAttacks(Square square, Bitboard block) {
+    return bishopAttacks(square, block) | rookAttacks(square, block);
+}
 
 void initLeaperAttacks();
+void initSliderAttacks();
+void initLines();
+
+bool checkSliderAttacks();
 } // namespace BBS
 
 #endif
@@ -82,6 +82,11 @@ inline i8 bitScanR(ui64 n) {
 #error No bitscan function
 #endif
 }
+inline i8 popLsb(ui64 &n) {
+    i8 idx = bitScanF(n);
+    n &= n - 1;
+    return idx;
+}
 } // namespace bits
 
 #endif //
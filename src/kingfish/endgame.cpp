@@ -0,0 +1,456 @@
+#include "endgame.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+
+#include "bitboard.h"
+#include "bits.h"
+#include "pieces.h"
+#include "zobrist.h"
+
+struct Endgame {
+    EndgameEval eval;
+    Color       strong;
+};
+
+// the endings with an evaluation of their own, by material key
+static std::unordered_map<ui64, Endgame> registry;
+
+// bonuses for a king at a distance of 0 to 7 squares from the other one,
+// and for a weak king far from its knight
+constexpr int PUSH_CLOSE[8] = {0, 0, 100, 80, 60, 40, 20, 10};
+constexpr int PUSH_AWAY[8]  = {0, 5, 20, 40, 60, 80, 90, 100};
+
+constexpr Bitboard FILE_A_BB = 0x0101010101010101ULL;
+constexpr Bitboard FILE_H_BB = FILE_A_BB << 7;
+
+static inline int distance(Square a, Square b) {
+    return std::max(std::abs(getFile(a) - getFile(b)),
+                    std::abs(getRank(a) - getRank(b)));
+}
+
+// every ending is evaluated as if the strong side were white, black's
+// squares are flipped vertically for it
+static inline Square relativeSquare(Color strong, Square square) {
+    return strong == CL_WHITE ? square : square ^ 56;
+}
+
+static inline bool isDark(Square square) {
+    return (getFile(square) + getRank(square)) % 2 == 0; // a1 is dark
+}
+
+// a bonus for a king the closer it is to the edge, up to 240 in a corner
+static inline int pushToEdge(Square square) {
+    int file = std::max(3 - getFile(square), getFile(square) - 4);
+    int rank = std::max(3 - getRank(square), getRank(square) - 4);
+    return 50 * std::max(file, rank) + 15 * (file + rank);
+}
+
+static inline int pushClose(Square a, Square b) {
+    return PUSH_CLOSE[distance(a, b)];
+}
+
+static inline int nonPawnMaterial(const Position &pos, Color side) {
+    int material = 0;
+    for (PieceType pt = PT_KNIGHT; pt <= PT_QUEEN; pt++) {
+        material += PIECE_VALUES[pt] * bits::popcount(pos.pieces(side, pt));
+    }
+    return material;
+}
+
+static inline int count(const Position &pos, Color side, PieceType pt) {
+    return bits::popcount(pos.pieces(side, pt));
+}
+
+// KPK, whether white wins with the king and pawn against the king, for the
+// pawn on files a to d (the others are mirrored) and either side to move
+namespace {
+const int KPK_SIZE = CL_COUNT * 24 * SQ_COUNT * SQ_COUNT;
+
+std::bitset<KPK_SIZE> kpk_wins;
+
+enum KpkResults : ui8 {
+
+    KPK_INVALID = 0,
+    KPK_UNKNOWN = 1,
+    KPK_DRAW    = 2,
+    KPK_WIN     = 4
+
+};
+
+int kpkIndex(Color stm, Square bk, Square wk, Square pawn) {
+    int p = getFile(pawn) * 6 + (getRank(pawn) - RANK_2);
+    return ((stm * 24 + p) * SQ_COUNT + wk) * SQ_COUNT + bk;
+}
+
+// what the rules alone say, before anything is searched
+ui8 kpkInitial(Color stm, Square bk, Square wk, Square pawn) {
+    Square push = pawn - 8;
+
+    if (distance(wk, bk) <= 1 || wk == pawn || bk == pawn ||
+        (stm == CL_WHITE && get_bit(BBS::pawnAttacks(CL_WHITE, pawn), bk))) {
+        return KPK_INVALID;
+    }
+
+    // the pawn promotes and the queen can't be taken
+    if (stm == CL_WHITE && getRank(pawn) == RANK_7 && wk != push &&
+        (distance(bk, push) > 1 || distance(wk, push) == 1)) {
+        return KPK_WIN;
+    }
+
+    // stalemate, or the pawn is taken
+    if (stm == CL_BLACK) {
+        Bitboard guarded =
+            BBS::kingAttacks(wk) | BBS::pawnAttacks(CL_WHITE, pawn);
+        if (!(BBS::kingAttacks(bk) & ~guarded) ||
+            get_bit(BBS::kingAttacks(bk) & ~BBS::kingAttacks(wk), pawn)) {
+            return KPK_DRAW;
+        }
+    }
+
+    return KPK_UNKNOWN;
+}
+
+// the best of what the moves lead to for the side to move
+ui8 kpkClassify(const std::vector<ui8> &db,
+                Color                   stm,
+                Square                  bk,
+                Square                  wk,
+                Square                  pawn) {
+    ui8 good = stm == CL_WHITE ? KPK_WIN : KPK_DRAW;
+    ui8 bad  = stm == CL_WHITE ? KPK_DRAW : KPK_WIN;
+
+    ui8 result = KPK_INVALID;
+    for (Bitboard moves = BBS::kingAttacks(stm == CL_WHITE ? wk : bk);
+         moves;) {
+        Square to = bits::popLsb(moves);
+        result |= stm == CL_WHITE ? db[kpkIndex(CL_BLACK, bk, to, pawn)]
+                                  : db[kpkIndex(CL_WHITE, to, wk, pawn)];
+    }
+
+    if (stm == CL_WHITE) {
+        // a push onto a king is an invalid position, so it adds nothing
+        if (getRank(pawn) < RANK_7) {
+            result |= db[kpkIndex(CL_BLACK, bk, wk, pawn - 8)];
+        }
+        if (getRank(pawn) == RANK_2 && pawn - 8 != wk && pawn - 8 != bk) {
+            result |= db[kpkIndex(CL_BLACK, bk, wk, pawn - 16)];
+        }
+    }
+
+    if (result & good) {
+        return good;
+    }
+    return result & KPK_UNKNOWN ? ui8(KPK_UNKNOWN) : bad;
+}
+
+void initKpk() {
+    std::vector<ui8> db(KPK_SIZE);
+
+    // every position once with the rules, then the unknown ones over and
+    // over until none of them changes
+    for (bool first = true, changed = true; changed; first = false) {
+        changed = false;
+        for (Color stm : {CL_WHITE, CL_BLACK}) {
+            for (BoardFile file = FL_A; file <= FL_D; file++) {
+                for (BoardRank rank = RANK_2; rank <= RANK_7; rank++) {
+                    Square pawn = getSquare(file, rank);
+                    for (Square wk = 0; wk < SQ_COUNT; wk++) {
+                        for (Square bk = 0; bk < SQ_COUNT; bk++) {
+                            ui8 &entry = db[kpkIndex(stm, bk, wk, pawn)];
+                            if (first) {
+                                entry = kpkInitial(stm, bk, wk, pawn);
+                            } else if (entry == KPK_UNKNOWN) {
+                                entry = kpkClassify(db, stm, bk, wk, pawn);
+                                changed |= entry != KPK_UNKNOWN;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        changed |= first;
+    }
+
+    for (int index = 0; index < KPK_SIZE; index++) {
+        kpk_wins[index] = db[index] == KPK_WIN;
+    }
+}
+} // namespace
+
+static int evaluateDraw(const Position &, Color) {
+    return 0;
+}
+
+// a lone king against enough to mate it: drive it to the edge
+static int evaluateKXK(const Position &pos, Color strong) {
+    Color  weak        = getOppositeColor(strong);
+    Square strong_king = pos.kingSquare(strong);
+    Square weak_king   = pos.kingSquare(weak);
+
+    int score = nonPawnMaterial(pos, strong) +
+                PIECE_VALUES[PT_PAWN] * count(pos, strong, PT_PAWN) +
+                pushToEdge(weak_king) + pushClose(strong_king, weak_king);
+
+    Bitboard bishops = pos.pieces(strong, PT_BISHOP);
+    if (pos.pieces(strong, PT_QUEEN) || pos.pieces(strong, PT_ROOK) ||
+        (bishops && pos.pieces(strong, PT_KNIGHT))) {
+        score += KNOWN_WIN;
+    } else {
+        // two bishops only mate on squares of both colours
+        bool dark = false, light = false;
+        for (Bitboard b = bishops; b;) {
+            (isDark(bits::popLsb(b)) ? dark : light) = true;
+        }
+        score += dark && light ? KNOWN_WIN : 0;
+    }
+
+    return score;
+}
+
+// bishop and knight: the king can only be mated in a corner the bishop's
+// colour, so it is driven towards one of those
+static int evaluateKBNK(const Position &pos, Color strong) {
+    Color  weak        = getOppositeColor(strong);
+    Square strong_king = pos.kingSquare(strong);
+    Square weak_king   = pos.kingSquare(weak);
+    bool   dark = isDark(bits::bitScanF(pos.pieces(strong, PT_BISHOP)));
+
+    int corner = dark ? std::min(distance(weak_king, SQ_A1),
+                                 distance(weak_king, SQ_H8))
+                      : std::min(distance(weak_king, SQ_A8),
+                                 distance(weak_king, SQ_H1));
+
+    return KNOWN_WIN + PIECE_VALUES[PT_KNIGHT] + PIECE_VALUES[PT_BISHOP] +
+           pushClose(strong_king, weak_king) + 60 * (7 - corner) +
+           pushToEdge(weak_king) / 4;
+}
+
+// king and pawn against king, exactly from the bitbase
+static int evaluateKPK(const Position &pos, Color strong) {
+    Color  weak        = getOppositeColor(strong);
+    Square strong_king = relativeSquare(strong, pos.kingSquare(strong));
+    Square weak_king   = relativeSquare(strong, pos.kingSquare(weak));
+    Square pawn =
+        relativeSquare(strong, bits::bitScanF(pos.pieces(strong, PT_PAWN)));
+
+    if (getFile(pawn) > FL_D) {
+        strong_king ^= 7, weak_king ^= 7, pawn ^= 7;
+    }
+
+    Color stm = pos.turn == strong ? CL_WHITE : CL_BLACK;
+    if (!kpk_wins[kpkIndex(stm, weak_king, strong_king, pawn)]) {
+        return 0;
+    }
+    return KNOWN_WIN + PIECE_VALUES[PT_PAWN] + 10 * getRank(pawn);
+}
+
+// rook against pawn, won unless the pawn is far advanced and supported
+static int evaluateKRKP(const Position &pos, Color strong) {
+    Color  weak        = getOppositeColor(strong);
+    Square strong_king = relativeSquare(strong, pos.kingSquare(strong));
+    Square weak_king   = relativeSquare(strong, pos.kingSquare(weak));
+    Square rook =
+        relativeSquare(strong, bits::bitScanF(pos.pieces(strong, PT_ROOK)));
+    Square pawn =
+        relativeSquare(strong, bits::bitScanF(pos.pieces(weak, PT_PAWN)));
+
+    // the pawn runs down the board, towards rank 1 once flipped
+    Square queening = getSquare(getFile(pawn), RANK_1);
+    Square stop     = pawn + 8;
+    int    rook_value = PIECE_VALUES[PT_ROOK];
+
+    if (getFile(strong_king) == getFile(pawn) &&
+        getRank(strong_king) < getRank(pawn)) {
+        // the strong king is in front of the pawn
+        return rook_value - distance(strong_king, pawn);
+    }
+    if (distance(weak_king, pawn) >= 3 + (pos.turn == weak) &&
+        distance(weak_king, rook) >= 3) {
+        // the weak king is too far from both to help
+        return rook_value - distance(strong_king, pawn);
+    }
+    if (getRank(weak_king) <= RANK_3 && distance(weak_king, pawn) == 1 &&
+        getRank(strong_king) >= RANK_4 &&
+        distance(strong_king, pawn) > 2 + (pos.turn == strong)) {
+        return 80 - 8 * distance(strong_king, pawn);
+    }
+    return 200 - 8 * (distance(strong_king, stop) -
+                      distance(weak_king, stop) - distance(pawn, queening));
+}
+
+// rook against a minor piece, usually a draw, better with the king cornered
+static int evaluateKRKB(const Position &pos, Color strong) {
+    return pushToEdge(pos.kingSquare(getOppositeColor(strong))) / 4;
+}
+
+static int evaluateKRKN(const Position &pos, Color strong) {
+    Color  weak      = getOppositeColor(strong);
+    Square weak_king = pos.kingSquare(weak);
+    Square knight    = bits::bitScanF(pos.pieces(weak, PT_KNIGHT));
+    return pushToEdge(weak_king) / 4 + PUSH_AWAY[distance(weak_king, knight)];
+}
+
+// queen against pawn, won unless a bishop or rook pawn on its 7th rank has
+// its king next to it
+static int evaluateKQKP(const Position &pos, Color strong) {
+    Color  weak        = getOppositeColor(strong);
+    Square strong_king = pos.kingSquare(strong);
+    Square weak_king   = pos.kingSquare(weak);
+    Square pawn        = bits::bitScanF(pos.pieces(weak, PT_PAWN));
+
+    int score = pushClose(strong_king, weak_king);
+
+    bool drawish = getRank(relativeSquare(strong, pawn)) == RANK_2 &&
+                   distance(weak_king, pawn) == 1 &&
+                   (getFile(pawn) == FL_A || getFile(pawn) == FL_C ||
+                    getFile(pawn) == FL_F || getFile(pawn) == FL_H);
+    if (!drawish) {
+        score += PIECE_VALUES[PT_QUEEN] - PIECE_VALUES[PT_PAWN];
+    }
+    return score;
+}
+
+static int evaluateKQKR(const Position &pos, Color strong) {
+    Square strong_king = pos.kingSquare(strong);
+    Square weak_king   = pos.kingSquare(getOppositeColor(strong));
+    return PIECE_VALUES[PT_QUEEN] - PIECE_VALUES[PT_ROOK] +
+           pushToEdge(weak_king) + pushClose(strong_king, weak_king);
+}
+
+// bishop and pawns on a rook file against the king: a draw when the bishop
+// doesn't cover the queening square and the king holds it
+static int scaleKBPsK(const Position &pos, Color strong) {
+    Bitboard pawns = pos.pieces(strong, PT_PAWN);
+    if ((pawns & ~FILE_A_BB) && (pawns & ~FILE_H_BB)) {
+        return SCALE_NONE;
+    }
+
+    Square bishop   = bits::bitScanF(pos.pieces(strong, PT_BISHOP));
+    Square queening = relativeSquare(
+        strong, getSquare(getFile(bits::bitScanF(pawns)), RANK_8));
+    Square weak_king = pos.kingSquare(getOppositeColor(strong));
+
+    if (isDark(bishop) != isDark(queening) &&
+        distance(weak_king, queening) <= 1) {
+        return SCALE_DRAW;
+    }
+    return SCALE_NONE;
+}
+
+// pawns on a rook file against the king, a draw with the king in front
+static int scaleKPsK(const Position &pos, Color strong) {
+    Bitboard pawns = pos.pieces(strong, PT_PAWN);
+    if ((pawns & ~FILE_A_BB) && (pawns & ~FILE_H_BB)) {
+        return SCALE_NONE;
+    }
+
+    // the most advanced pawn, the lowest square once flipped for white
+    Square front     = strong == CL_WHITE ? bits::bitScanF(pawns)
+                                          : bits::bitScanR(pawns);
+    Square weak_king = pos.kingSquare(getOppositeColor(strong));
+    if (std::abs(getFile(weak_king) - getFile(front)) <= 1 &&
+        getRank(relativeSquare(strong, weak_king)) >
+            getRank(relativeSquare(strong, front))) {
+        return SCALE_DRAW;
+    }
+    return SCALE_NONE;
+}
+
+// bishops of opposite colours and pawns, hard to win even a few pawns up
+static int scaleOppositeBishops(const Position &pos, Color strong) {
+    Color weak = getOppositeColor(strong);
+    if (isDark(bits::bitScanF(pos.pieces(strong, PT_BISHOP))) ==
+        isDark(bits::bitScanF(pos.pieces(weak, PT_BISHOP)))) {
+        return SCALE_NONE;
+    }
+
+    int extra = count(pos, strong, PT_PAWN) - count(pos, weak, PT_PAWN);
+    return std::min(SCALE_NORMAL, 16 + 8 * std::max(extra, 0));
+}
+
+static void add(const std::string &code, EndgameEval eval) {
+    for (Color strong : {CL_WHITE, CL_BLACK}) {
+        registry[materialHash(code, strong)] = {eval, strong};
+    }
+}
+
+void Endgames::init() {
+    initKpk();
+
+    add("KNNK", evaluateDraw);
+    add("KBNK", evaluateKBNK);
+    add("KPK", evaluateKPK);
+    add("KRKP", evaluateKRKP);
+    add("KRKB", evaluateKRKB);
+    add("KRKN", evaluateKRKN);
+    add("KQKP", evaluateKQKP);
+    add("KQKR", evaluateKQKR);
+}
+
+static void computeMaterial(const Position &pos, MaterialEntry &entry) {
+    entry     = MaterialEntry();
+    entry.key = pos.material_key;
+
+    auto found = registry.find(pos.material_key);
+    if (found != registry.end()) {
+        entry.eval   = found->second.eval;
+        entry.strong = found->second.strong;
+        return;
+    }
+
+    int npm[CL_COUNT]   = {nonPawnMaterial(pos, CL_WHITE),
+                           nonPawnMaterial(pos, CL_BLACK)};
+    int pawns[CL_COUNT] = {count(pos, CL_WHITE, PT_PAWN),
+                           count(pos, CL_BLACK, PT_PAWN)};
+
+    for (Color strong : {CL_WHITE, CL_BLACK}) {
+        Color weak      = getOppositeColor(strong);
+        bool  bare_king = npm[weak] == 0 && pawns[weak] == 0;
+
+        // the generic endings for any amount against a lone king
+        if (bare_king && npm[strong] >= PIECE_VALUES[PT_ROOK]) {
+            entry.eval   = evaluateKXK;
+            entry.strong = strong;
+            return;
+        }
+        if (bare_king && npm[strong] == PIECE_VALUES[PT_BISHOP] &&
+            count(pos, strong, PT_BISHOP) == 1 && pawns[strong] > 0) {
+            entry.scale_fns[strong] = scaleKBPsK;
+        }
+        if (bare_king && npm[strong] == 0 && pawns[strong] > 1) {
+            entry.scale_fns[strong] = scaleKPsK;
+        }
+
+        // without pawns, a minor piece more is not enough
+        if (pawns[strong] == 0 &&
+            npm[strong] - npm[weak] <= PIECE_VALUES[PT_BISHOP]) {
+            entry.scales[strong] = npm[strong] < PIECE_VALUES[PT_ROOK] ? 0
+                                   : npm[weak] <= PIECE_VALUES[PT_BISHOP]
+                                       ? 4
+                                       : 14;
+        }
+    }
+
+    // without pawns the static scales above already say draw
+    if (pawns[CL_WHITE] + pawns[CL_BLACK] > 0 &&
+        npm[CL_WHITE] == PIECE_VALUES[PT_BISHOP] &&
+        npm[CL_BLACK] == PIECE_VALUES[PT_BISHOP] &&
+        count(pos, CL_WHITE, PT_BISHOP) == 1 &&
+        count(pos, CL_BLACK, PT_BISHOP) == 1) {
+        entry.scale_fns[CL_WHITE] = scaleOppositeBishops;
+        entry.scale_fns[CL_BLACK] = scaleOppositeBishops;
+    }
+}
+
+const MaterialEntry &MaterialTable::probe(const Position &pos) {
+    MaterialEntry &entry =
+        this->entries[pos.material_key & (MATERIAL_TABLE_SIZE - 1)];
+    if (entry.key != pos.material_key) {
+        computeMaterial(pos, entry);
+    }
+    return entry;
+}
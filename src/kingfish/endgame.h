@@ -0,0 +1,62 @@
+#ifndef KINGFISH_ENDGAME_H
+#define KINGFISH_ENDGAME_H
+
+#include <vector>
+
+#include "position.h"
+#include "types.h"
+
+// the evaluation of a won ending, clear of anything the eval can reach but
+// well below the mate scores
+const int KNOWN_WIN = 10000;
+
+// what the eval is multiplied by, in SCALE_NORMALths, when the side it
+// favours can't expect to convert what it has
+const int SCALE_DRAW   = 0;
+const int SCALE_NORMAL = 64;
+const int SCALE_NONE   = -1; // the scale function doesn't apply
+
+// the score of an ending for the strong side, and its scale factor
+typedef int (*EndgameEval)(const Position &pos, Color strong);
+typedef int (*EndgameScale)(const Position &pos, Color strong);
+
+namespace Endgames {
+// builds the registry and the KPK bitbase, needs the bitboard tables
+void init();
+} // namespace Endgames
+
+const int MATERIAL_TABLE_SIZE = 1 << 12; // entries, 160KB per thread
+
+struct MaterialEntry { // what a material configuration says, by material_key
+    ui64         key  = 0;
+    EndgameEval  eval = nullptr; // replaces the eval when there is one
+    EndgameScale scale_fns[CL_COUNT] = {}; // by the side the eval favours
+    Color        strong              = CL_WHITE; // the side eval is for
+    ui8          scales[CL_COUNT]    = {SCALE_NORMAL, SCALE_NORMAL};
+
+    inline int scale(const Position &pos, Color favoured) const {
+        if (this->scale_fns[favoured]) {
+            int scale = this->scale_fns[favoured](pos, favoured);
+            if (scale != SCALE_NONE) {
+                return scale;
+            }
+        }
+        return this->scales[favoured];
+    }
+};
+
+// Piece counts change even less often than the pawns, so what they mean
+// for the eval is kept by material key: in the middlegame a lookup only
+// finds no ending and the usual scale. Each search thread has its own.
+class MaterialTable {
+  public:
+    MaterialTable()
+        : entries(MATERIAL_TABLE_SIZE) {}
+
+    const MaterialEntry &probe(const Position &pos);
+
+  private:
+    std::vector<MaterialEntry> entries;
+};
+
+#endif // !KINGFISH_ENDGAME_H
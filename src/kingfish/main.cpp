@@ -1,8 +1,12 @@
 #include "bitboard.h"
+#include "endgame.h"
 #include "uci.h"
 
 int main() {
     BBS::initLeaperAttacks(); // set up bitboard magic
+    BBS::initSliderAttacks();
+    BBS::initLines();
+    Endgames::init(); // needs the attack tables
     // // // blocker bitboard
     // Bitboard block = 0ULL;
 
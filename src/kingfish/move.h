@@ -1,36 +1,37 @@
 #ifndef KINGFISH_MOVE_H
 #define KINGFISH_MOVE_H
 
-#include "pieces.h"
+#include "types.h"
 
+// a move packed into 16 bits:
+//   bits 0-5   from square
+//   bits 6-11  to square
+//   bits 12-15 flags, the promotion piece type or 0 (a pawn can't be one)
 struct Move {
-    int i = 0;
-    int j = 0;
-
-    int value = 0;
-
-    char prom = ' ';
+    ui16 data = 0;
 
     Move() = default;
-    Move(int _i, int _j, char _prom)
-        : i(_i)
-        , j(_j)
-        , prom(_prom) {}
+    constexpr Move(Square from, Square to, PieceType prom = PT_NONE)
+        : data(ui16(from | (to << 6) |
+                    ((prom == PT_NONE ? 0 : prom) << 12))) {}
 
-    inline bool operator==(const Move &m) const {
-        return (j == m.j) && (i == m.i) && (prom == m.prom);
-    }
-    inline bool operator!=(const Move &m) const {
-        return (j != m.j) || (i != m.i) || (prom != m.prom);
-    }
-    inline bool operator<(const Move &m) const {
-        return std::tie(i, j, prom) < std::tie(m.i, m.j, m.prom);
-    }
-    inline bool operator>(const Move &m) const {
-        return std::tie(i, j, prom) > std::tie(m.i, m.j, m.prom);
+    constexpr Square from() const { return data & 0x3f; }
+    constexpr Square to() const { return (data >> 6) & 0x3f; }
+    constexpr int    flags() const { return data >> 12; }
+
+    constexpr bool      isPromotion() const { return flags() != 0; }
+    constexpr PieceType promotion() const {
+        return isPromotion() ? PieceType(flags()) : PieceType(PT_NONE);
     }
+
+    inline bool operator==(const Move &m) const { return data == m.data; }
+    inline bool operator!=(const Move &m) const { return data != m.data; }
+    inline bool operator<(const Move &m) const { return data < m.data; }
+    inline bool operator>(const Move &m) const { return data > m.data; }
 };
 
-const Move NULLMOVE = Move(0, 0, ' ');
+static_assert(sizeof(Move) == 2);
+
+const Move NULLMOVE = Move();
 
-#endif // !KINGFISH_MOVE_H
\ No newline at end of file
+#endif // !KINGFISH_MOVE_H
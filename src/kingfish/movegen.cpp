@@ -0,0 +1,156 @@
+#include "movegen.h"
+
+#include "bitboard.h"
+#include "bits.h"
+#include "position.h"
+
+static void addPawnMoves(Square    from,
+                         Square    to,
+                         bool      capture,
+                         GenType   type,
+                         MoveList &moves) {
+    if (!((1ULL << to) & (BBS::rank_8 | BBS::rank_1))) {
+        if (capture || type != GEN_CAPTURES) {
+            moves.push_back(Move(from, to));
+        }
+        return;
+    }
+
+    // a queen promotion is noisy even without a capture, the
+    // underpromotions only are when they capture something
+    for (PieceType prom : {PT_KNIGHT, PT_BISHOP, PT_ROOK, PT_QUEEN}) {
+        bool noisy = capture || prom == PT_QUEEN;
+        if (type == GEN_ALL || noisy == (type == GEN_CAPTURES)) {
+            moves.push_back(Move(from, to, prom));
+        }
+    }
+}
+
+void generateMoves(const Position &pos, GenType type, MoveList &moves) {
+    Color    us    = pos.turn;
+    Color    them  = getOppositeColor(us);
+    Bitboard own   = pos.occupied_bitboards[us];
+    Bitboard enemy = pos.occupied_bitboards[them];
+    Bitboard occ   = own | enemy;
+    Square   king  = pos.kingSquare(us);
+
+    Bitboard checkers = pos.attackersTo(king, occ) & enemy;
+    Bitboard pinned   = pos.pinnedPieces(us);
+
+    // squares the side to move may go to with a piece that is not a pawn
+    Bitboard targets = type == GEN_CAPTURES ? enemy
+                       : type == GEN_QUIETS ? ~occ
+                                            : ~own;
+
+    // king moves, the king is taken off the board so that it cannot hide
+    // behind itself from a slider giving check
+    Bitboard king_moves = BBS::kingAttacks(king) & targets;
+    while (king_moves) {
+        Square to = bits::popLsb(king_moves);
+        if (!(pos.attackersTo(to, occ ^ (1ULL << king)) & enemy)) {
+            moves.push_back(Move(king, to));
+        }
+    }
+
+    if (bits::popcount(checkers) > 1) {
+        return; // double check, only the king can move
+    }
+
+    // in check the other pieces have to capture the checker or block
+    Bitboard evasions = ~0ULL;
+    if (checkers) {
+        Square checker = bits::bitScanF(checkers);
+        evasions       = BBS::betweenBB(king, checker) | checkers;
+    }
+
+    int      push  = us == CL_WHITE ? -8 : 8;
+    Bitboard home  = us == CL_WHITE ? BBS::rank_2 : BBS::rank_7;
+
+    for (Bitboard pawns = pos.pieces(us, PT_PAWN); pawns;) {
+        Square   from = bits::popLsb(pawns);
+        Bitboard pin  = get_bit(pinned, from) ? BBS::lineBB(king, from) : ~0ULL;
+        Square   to   = from + push;
+
+        if (!get_bit(occ, to)) {
+            if (get_bit(evasions & pin, to)) {
+                addPawnMoves(from, to, false, type, moves);
+            }
+            if (type != GEN_CAPTURES && get_bit(home, from) &&
+                !get_bit(occ, to + push) && get_bit(evasions & pin, to + push)) {
+                moves.push_back(Move(from, to + push));
+            }
+        }
+
+        if (type == GEN_QUIETS) {
+            continue;
+        }
+
+        Bitboard captures = BBS::pawnAttacks(us, from) & enemy & evasions & pin;
+        while (captures) {
+            addPawnMoves(from, bits::popLsb(captures), true, type, moves);
+        }
+
+        if (pos.ep != SQ_INVALID &&
+            get_bit(BBS::pawnAttacks(us, from), pos.ep)) {
+            // en passant removes two pieces from the board at once, so the
+            // pin and evasion masks are not enough, try it on the board
+            Square   captured = pos.ep - push;
+            Bitboard after =
+                (occ ^ (1ULL << from) ^ (1ULL << captured)) | (1ULL << pos.ep);
+
+            if (!(pos.attackersTo(king, after) & enemy & ~(1ULL << captured))) {
+                moves.push_back(Move(from, pos.ep));
+            }
+        }
+    }
+
+    for (PieceType pt = PT_KNIGHT; pt <= PT_QUEEN; pt++) {
+        for (Bitboard bb = pos.pieces(us, pt); bb;) {
+            Square   from = bits::popLsb(bb);
+            Bitboard to_bb;
+
+            switch (pt) {
+                case PT_KNIGHT: to_bb = BBS::knightAttacks(from); break;
+                case PT_BISHOP: to_bb = BBS::bishopAttacks(from, occ); break;
+                case PT_ROOK: to_bb = BBS::rookAttacks(from, occ); break;
+                default: to_bb = BBS::queenAttacks(from, occ); break;
+            }
+
+            to_bb &= targets & evasions;
+            if (get_bit(pinned, from)) {
+                to_bb &= BBS::lineBB(king, from);
+            }
+
+            while (to_bb) {
+                moves.push_back(Move(from, bits::popLsb(to_bb)));
+            }
+        }
+    }
+
+    // castling, the king may not leave, cross or land on an attacked square
+    if (type == GEN_CAPTURES || checkers) {
+        return;
+    }
+
+    Square start = us == CL_WHITE ? SQ_E1 : SQ_E8;
+    ui8    oo    = us == CL_WHITE ? CR_WHITE_OO : CR_BLACK_OO;
+    ui8    ooo   = us == CL_WHITE ? CR_WHITE_OOO : CR_BLACK_OOO;
+
+    if (king != start) {
+        return;
+    }
+
+    auto safe = [&](Square s) {
+        return !(pos.attackersTo(s, occ) & enemy);
+    };
+
+    if ((pos.castling_rights & oo) && !get_bit(occ, king + 1) &&
+        !get_bit(occ, king + 2) && safe(king + 1) && safe(king + 2)) {
+        moves.push_back(Move(king, king + 2));
+    }
+    if ((pos.castling_rights & ooo) && !get_bit(occ, king - 1) &&
+        !get_bit(occ, king - 2) && !get_bit(occ, king - 3) &&
+        safe(king - 1) && safe(king - 2)) {
+        moves.push_back(Move(king, king - 2));
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef KINGFISH_MOVEGEN_H
+#define KINGFISH_MOVEGEN_H
+
+#include <utility>
+
+#include "move.h"
+#include "types.h"
+
+class Position;
+
+const int MAX_MOVES = 218; // the most legal moves any chess position has
+
+// Fixed capacity move list that lives on the stack, with an ordering score
+// kept next to every move for the move picker.
+class MoveList {
+  public:
+    inline void push_back(const Move &move, int score = 0) {
+        this->moves[this->count]  = move;
+        this->scores[this->count] = score;
+        this->count++;
+    }
+    inline void clear() { this->count = 0; }
+
+    inline int  size() const { return this->count; }
+    inline bool empty() const { return this->count == 0; }
+
+    inline Move       &operator[](int index) { return this->moves[index]; }
+    inline const Move &operator[](int index) const {
+        return this->moves[index];
+    }
+    inline int &score(int index) { return this->scores[index]; }
+
+    inline Move       *begin() { return this->moves; }
+    inline Move       *end() { return this->moves + this->count; }
+    inline const Move *begin() const { return this->moves; }
+    inline const Move *end() const { return this->moves + this->count; }
+
+    inline void swap(int a, int b) {
+        std::swap(this->moves[a], this->moves[b]);
+        std::swap(this->scores[a], this->scores[b]);
+    }
+
+  private:
+    Move moves[MAX_MOVES];
+    int  scores[MAX_MOVES];
+    int  count = 0;
+};
+
+typedef i8 GenType;
+
+enum GenTypes {
+
+    GEN_CAPTURES, // captures, en passant and queen promotions
+    GEN_QUIETS,   // everything else, castling and underpromotions included
+    GEN_ALL
+
+};
+
+// appends the legal moves of the given kind for the side to move
+void generateMoves(const Position &pos, GenType type, MoveList &moves);
+
+#endif // !KINGFISH_MOVEGEN_H
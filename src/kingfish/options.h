@@ -1,6 +1,8 @@
 #ifndef KINGFISH_OPTIONS_H
 #define KINGFISH_OPTIONS_H
 
+#include <algorithm>
+#include <charconv>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -8,6 +10,7 @@
 
 class Option {
   public:
+    Option() = default;
     Option(const std::string& _name,
            const std::string& _defaultValue,
            const std::string& _type,
@@ -15,12 +18,14 @@ class Option {
            const std::string& _max = "")
         : name(_name)
         , defaultValue(_defaultValue)
+        , value(_defaultValue)
         , type(_type)
         , min(_min)
         , max(_max) {}
 
     std::string name;
     std::string defaultValue;
+    std::string value;
     std::string type;
     std::string min;
     std::string max;
@@ -51,37 +56,103 @@ class Options {
         addOption("Syzygy50MoveRule", "true", "check");
         addOption("SyzygyProbeLimit", "7", "spin", "0", "7");
         addOption("Use NNUE", "true", "check");
-        addOption("EvalFile", "nn-ad9b42354671.nnue", "string");
+        addOption("Use PVS", "true", "check");
+        addOption("LMR", "true", "check");
+        addOption("LMR Base", "75", "spin", "0", "400");
+        addOption("LMR Divisor", "225", "spin", "50", "1000");
+        addOption("LMR Min Depth", "3", "spin", "1", "20");
+        addOption("LMR Min Moves", "3", "spin", "1", "64");
+        addOption("RFP", "true", "check");
+        addOption("RFP Depth", "6", "spin", "1", "20");
+        addOption("RFP Margin", "80", "spin", "0", "1000");
+        addOption("Futility", "true", "check");
+        addOption("Futility Depth", "6", "spin", "1", "20");
+        addOption("Futility Margin", "100", "spin", "0", "1000");
+        addOption("LMP", "true", "check");
+        addOption("LMP Depth", "4", "spin", "1", "20");
+        addOption("LMP Base", "3", "spin", "0", "100");
+        addOption("SEE Pruning", "true", "check");
+        addOption("SEE Depth", "8", "spin", "1", "20");
+        addOption("SEE Quiet Margin", "60", "spin", "0", "1000");
+        addOption("Check Extensions", "true", "check");
+        addOption("EvalFile", "kingfish.nnue", "string");
     }
 
     // Get the value of an option by key
     std::string getOptionValue(const std::string& key) const {
         auto iter = options.find(key);
         if (iter != options.end()) {
-            return iter->second;
+            return iter->second.value;
         } else {
             return "";
         }
     }
 
+    int getIntValue(const std::string& key) const {
+        int v = 0;
+        parseInt(getOptionValue(key), v);
+        return v;
+    }
+
+    bool getBoolValue(const std::string& key) const {
+        return getOptionValue(key) == "true";
+    }
+
+    bool hasOption(const std::string& key) const {
+        return options.find(key) != options.end();
+    }
+
+    // The whole of text as a number, false when it is anything else
+    static bool parseInt(const std::string& text, int& v) {
+        const char* end   = text.data() + text.size();
+        auto [ptr, error] = std::from_chars(text.data(), end, v);
+        return error == std::errc() && ptr == end && !text.empty();
+    }
+
+    // Set the value of an option, spin values are clamped to their range.
+    // Returns false for unknown options and for spin values that aren't a
+    // number, which leave the option as it was
+    bool setOptionValue(const std::string& key, const std::string& value) {
+        auto iter = options.find(key);
+        if (iter == options.end()) {
+            return false;
+        }
+
+        Option& option = iter->second;
+        if (option.type == "spin") {
+            int v, min, max;
+            if (!parseInt(value, v) || !parseInt(option.min, min) ||
+                !parseInt(option.max, max)) {
+                return false;
+            }
+            v            = std::clamp(v, min, max);
+            option.value = std::to_string(v);
+        } else {
+            option.value = value;
+        }
+        return true;
+    }
+
     // Add a new option
     void addOption(const std::string& name,
                    const std::string& defaultValue,
                    const std::string& type,
                    const std::string& min = "",
                    const std::string& max = "") {
-        Option option(name, defaultValue, type, min, max);
-        options[name]     = defaultValue;
-        optionTypes[name] = option;
+        options[name] = Option(name, defaultValue, type, min, max);
     }
 
     // Print all options in UCI format
     void printOptions() const {
-        for (const auto& pair : optionTypes) {
+        for (const auto& pair : options) {
             const Option&     option = pair.second;
             std::stringstream ss;
-            ss << "option name " << option.name << " type " << option.type
-               << " default " << option.defaultValue;
+            ss << "option name " << option.name << " type " << option.type;
+            if (option.type != "button") {
+                ss << " default "
+                   << (option.defaultValue.empty() ? "<empty>"
+                                                   : option.defaultValue);
+            }
             if (option.type == "spin") {
                 ss << " min " << option.min << " max " << option.max;
             }
@@ -90,16 +161,9 @@ class Options {
     }
 
   private:
-    struct Option {
-        std::string name;
-        std::string type;
-        std::string defaultValue;
-        int         min;
-        int         max;
-    };
-
-    std::unordered_map<std::string, Option>      optionTypes;
-    std::unordered_map<std::string, std::string> optionValues;
+    std::map<std::string, Option> options;
 };
 
-#endif
\ No newline at end of file
+extern Options options; // defined in uci.cpp
+
+#endif
@@ -0,0 +1,107 @@
+#include "perft.h"
+
+#include <bit>
+#include <thread>
+
+#include "movegen.h"
+
+PerftTable::PerftTable(std::size_t mb) {
+    std::size_t count = std::bit_floor(mb * 1024 * 1024 / sizeof(Entry));
+
+    this->entries = std::make_unique<Entry[]>(count);
+    this->mask    = count - 1;
+}
+
+bool PerftTable::probe(PositionHash hash, int depth, ui64 &nodes) const {
+    const Entry &entry = this->entries[ui64(hash) & this->mask];
+
+    ui64 data = entry.data.load(std::memory_order_relaxed);
+    ui64 key  = entry.key.load(std::memory_order_relaxed);
+
+    if ((key ^ data) != ui64(hash) || int(data & 0xff) != depth) {
+        return false;
+    }
+
+    nodes = data >> 8;
+    return true;
+}
+
+void PerftTable::store(PositionHash hash, int depth, ui64 nodes) {
+    Entry &entry = this->entries[ui64(hash) & this->mask];
+    ui64   data  = nodes << 8 | ui64(depth);
+
+    entry.key.store(ui64(hash) ^ data, std::memory_order_relaxed);
+    entry.data.store(data, std::memory_order_relaxed);
+}
+
+ui64 perft(Position &pos, int depth, PerftTable *table) {
+    if (depth == 0) {
+        return 1;
+    }
+
+    MoveList moves;
+    generateMoves(pos, GEN_ALL, moves);
+
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    PositionHash hash  = 0;
+    ui64         nodes = 0;
+    if (table) {
+        hash = pos.hash();
+        if (table->probe(hash, depth, nodes)) {
+            return nodes;
+        }
+    }
+
+    Status status;
+    for (const Move &move : moves) {
+        pos.makeMove(move, status);
+        nodes += perft(pos, depth - 1, table);
+        pos.unmakeMove(move, status);
+    }
+
+    if (table) {
+        table->store(hash, depth, nodes);
+    }
+
+    return nodes;
+}
+
+DivideResult divide(const Position &pos,
+                    int             depth,
+                    int             threads,
+                    PerftTable     *table) {
+    MoveList moves;
+    generateMoves(pos, GEN_ALL, moves);
+
+    DivideResult result;
+    for (const Move &move : moves) {
+        result.emplace_back(move, 0);
+    }
+
+    std::atomic<int> next = 0;
+    auto             work = [&]() {
+        Position local = pos;
+        Status   status;
+
+        for (int k; (k = next++) < int(result.size());) {
+            local.makeMove(result[k].first, status);
+            result[k].second = perft(local, depth - 1, table);
+            local.unmakeMove(result[k].first, status);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+        workers.emplace_back(work);
+    }
+    work();
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    return result;
+}
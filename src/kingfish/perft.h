@@ -0,0 +1,48 @@
+#ifndef KINGFISH_PERFT_H
+#define KINGFISH_PERFT_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "move.h"
+#include "position.h"
+#include "types.h"
+
+const std::size_t PERFT_HASH_MB = 16;
+
+class PerftTable { // node counts of subtrees, shared between threads
+  public:
+    explicit PerftTable(std::size_t mb = PERFT_HASH_MB);
+
+    bool probe(PositionHash hash, int depth, ui64 &nodes) const;
+    void store(PositionHash hash, int depth, ui64 nodes);
+
+  private:
+    // the key is stored xor'ed with the data, so an entry torn by two
+    // threads writing it at once fails the check instead of being read
+    struct Entry {
+        std::atomic<ui64> key  = 0;
+        std::atomic<ui64> data = 0; // nodes << 8 | depth
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::size_t              mask;
+};
+
+typedef std::vector<std::pair<Move, ui64>> DivideResult;
+
+// counts the leaf nodes of the legal move tree, depth 1 nodes are counted
+// from the size of the move list instead of being visited
+ui64 perft(Position &pos, int depth, PerftTable *table = nullptr);
+
+// the node count under each root move, the root moves are shared out
+// between the threads
+DivideResult divide(const Position &pos,
+                    int             depth,
+                    int             threads = 1,
+                    PerftTable     *table   = nullptr);
+
+#endif // !KINGFISH_PERFT_H
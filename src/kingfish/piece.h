@@ -80,6 +80,6 @@ static Piece STARTING_POSITION[64] = {
     WHITE_KING,   WHITE_BISHOP, WHITE_KNIGHT, WHITE_ROOK};
 
 static const char PIECE_IDENTIFIER[CL_COUNT][PT_COUNT] = {
-    {'.', 'P', 'N', 'B', 'R', 'Q', 'K'}, {'.', 'p', 'n', 'b', 'r', 'q', 'k'}};
+    {'P', 'N', 'B', 'R', 'Q', 'K', '.'}, {'p', 'n', 'b', 'r', 'q', 'k', '.'}};
 
 #endif
\ No newline at end of file
@@ -1,91 +1,164 @@
 #ifndef KINGFISH_PIECES_H
 #define KINGFISH_PIECES_H
 
-#include <array>
-#include <unordered_map>
+#include "types.h"
 
-// clang-format off
-static std::unordered_map<char, std::array<int, 120>> PIECE_SQUARE_TABLES = {
-    {'P',
-     {0,    0,   0,   0,   0,   0,   0,   0,   0,   0,
-      0,    0,   0,   0,   0,   0,   0,   0,   0,   0,
-      0,   100, 100, 100, 100, 100, 100, 100, 100,  0,
-      0,   178, 183, 186, 173, 202, 182, 185, 190,  0, 
-      0,   107, 129, 121, 144, 140, 131, 144, 107,  0,
-      0,   83,  116, 98,  115, 114, 100, 115, 87,   0,
-      0,   74,  103, 110, 109, 106, 101, 100, 77,   0,
-      0,   78,  109, 105, 89,   90,  98, 103, 81,   0,
-      0,   69,  108, 93,  63,  64,  86,  103, 69,   0,
-      0,   100, 100, 100, 100, 100, 100, 100, 100,  0,
-      0,     0,   0,   0,   0,   0,   0,   0,   0,  0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,  0}},
-    {'N',
-     {0,     0,   0,   0,   0,   0,   0,   0,   0,  0,
-      0,     0,   0,   0,   0,   0,   0,   0,   0,  0,
-      0,   214, 227, 205, 205, 270, 225, 222, 210,  0,
-      0,   277, 274, 380, 244, 284, 342, 276, 266,  0,   
-      0,   290, 347, 281, 354, 353, 307, 342, 278,  0,   
-      0,   304, 304, 325, 317, 313, 321, 305, 297,  0,
-      0,   279, 285, 311, 301, 302, 315, 282, 280,  0,   
-      0,   262, 290, 293, 302, 298, 295, 291, 266,  0,   
-      0,   257, 265, 282, 280, 282, 280, 257, 260,  0,
-      0,   206, 257, 254, 256, 261, 245, 258, 211,  0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,  0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,  0}},
-    {'B',
-     {0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,   261, 242, 238, 244, 297, 213, 283, 270,   0,
-      0,   309, 340, 355, 278, 281, 351, 322, 298,   0,   
-      0,   311, 359, 288, 361, 372, 310, 348, 306,   0,   
-      0,   345, 337, 340, 354, 346, 345, 335, 330,   0,
-      0,   333, 330, 337, 343, 337, 336, 320, 327,   0,   
-      0,   334, 345, 344, 335, 328, 345, 340, 335,   0,   
-      0,   339, 340, 331, 326, 327, 326, 340, 336,   0,
-      0,   313, 322, 305, 308, 306, 305, 310, 310,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0}},
-    {'R',
-     {0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,   514, 508, 512, 483, 516, 512, 535, 529,   0,
-      0,   534, 508, 535, 546, 534, 541, 513, 539,   0,   
-      0,   498, 514, 507, 512, 524, 506, 504, 494,   0,   
-      0,   479, 484, 495, 492, 497, 475, 470, 473,   0,
-      0,   451, 444, 463, 458, 466, 450, 433, 449,   0,   
-      0,   437, 451, 437, 454, 454, 444, 453, 433,   0,   
-      0,   426, 441, 448, 453, 450, 436, 435, 426,   0,
-      0,   449, 455, 461, 484, 477, 461, 448, 447,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0}},
-    {'Q',
-     {0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,     0,   0,   0,   0,   0,   0,   0,   0,   0,   
-      0,   935, 930, 921, 825, 998, 953,1017, 955,   0,  
-      0,   943, 961, 989, 919, 949,1005, 986, 953,   0,   
-      0,   927, 972, 961, 989, 1001,992, 972, 931,   0,   
-      0,   930, 913, 951, 946, 954, 949, 916, 923,   0,    
-      0,   915, 914, 927, 924, 928, 919, 909, 907,   0,
-      0,   899, 923, 916, 918, 913, 918, 913, 902,   0,   
-      0,   893, 911, 929, 910, 914, 914, 908, 891,   0,   
-      0,   890, 899, 898, 916, 898, 893, 895, 887,   0,   
-      0,     0,   0,   0,   0,   0,   0,    0,   0,  0,  
-      0,     0,   0,   0,   0,   0,   0,    0,   0,  0}},
-    {'K', 
-     {0, 0,     0,     0,     0,     0,     0,     0,     0,     0,
-      0, 0,     0,     0,     0,     0,     0,     0,     0,     0,
-      0, 60004, 60054, 60047, 59901, 59901, 60060, 60083, 59938, 0,
-      0, 59968, 60010, 60055, 60056, 60056, 60055, 60010, 60003, 0,
-      0, 59938, 60012, 59943, 60044, 59933, 60028, 60037, 59969, 0,
-      0, 59945, 60050, 60011, 59996, 59981, 60013, 60000, 59951, 0,
-      0, 59945, 59957, 59948, 59972, 59949, 59953, 59992, 59950, 0,
-      0, 59953, 59958, 59957, 59921, 59936, 59968, 59971, 59968, 0,
-      0, 59996, 60003, 59986, 59950, 59943, 59982, 60013, 60004, 0,
-      0, 60017, 60030, 59997, 59986, 60006, 59999, 60040, 60018, 0,
-      0, 0,     0,     0,     0,     0,     0,     0,     0,     0,
-      0, 0,     0,     0,     0,     0,     0,     0,     0,     0}}};
-// clang-format on
-static std::unordered_map<char, int> PIECE_VALUES = {
-    {'P', 100}, {'N', 280}, {'B', 320}, {'R', 429}, {'Q', 929}, {'K', 60000}};
+// material, indexed by PieceType, the king is worth more than any amount of
+// the rest so that losing it decides the score
+inline constexpr int PIECE_VALUES[PT_COUNT] = {
+    100, 280, 320, 429, 929, 60000, 0};
 
-#endif // !KINGFISH_PIECES_H
\ No newline at end of file
+// what each piece adds to the game phase, which is PHASE_MAX with all of
+// them on the board and 0 with only kings and pawns left
+inline constexpr int PHASE_WEIGHTS[PT_COUNT] = {0, 1, 1, 2, 4, 0, 0};
+inline constexpr int PHASE_MAX               = 24;
+
+// piece-square tables, material included, indexed by PieceType and square
+// (SQ_A8 = 0) as seen by white, black's are rotated by 180 degrees. the
+// middlegame ones are sunfish's, the endgame ones add PeSTO's endgame
+// square bonuses to the same material
+inline constexpr int PST_MG[PT_COUNT][SQ_COUNT] = {
+    // clang-format off
+    // pawn
+    {
+         100,  100,  100,  100,  100,  100,  100,  100,
+         178,  183,  186,  173,  202,  182,  185,  190,
+         107,  129,  121,  144,  140,  131,  144,  107,
+          83,  116,   98,  115,  114,  100,  115,   87,
+          74,  103,  110,  109,  106,  101,  100,   77,
+          78,  109,  105,   89,   90,   98,  103,   81,
+          69,  108,   93,   63,   64,   86,  103,   69,
+         100,  100,  100,  100,  100,  100,  100,  100,
+    },
+    // knight
+    {
+         214,  227,  205,  205,  270,  225,  222,  210,
+         277,  274,  380,  244,  284,  342,  276,  266,
+         290,  347,  281,  354,  353,  307,  342,  278,
+         304,  304,  325,  317,  313,  321,  305,  297,
+         279,  285,  311,  301,  302,  315,  282,  280,
+         262,  290,  293,  302,  298,  295,  291,  266,
+         257,  265,  282,  280,  282,  280,  257,  260,
+         206,  257,  254,  256,  261,  245,  258,  211,
+    },
+    // bishop
+    {
+         261,  242,  238,  244,  297,  213,  283,  270,
+         309,  340,  355,  278,  281,  351,  322,  298,
+         311,  359,  288,  361,  372,  310,  348,  306,
+         345,  337,  340,  354,  346,  345,  335,  330,
+         333,  330,  337,  343,  337,  336,  320,  327,
+         334,  345,  344,  335,  328,  345,  340,  335,
+         339,  340,  331,  326,  327,  326,  340,  336,
+         313,  322,  305,  308,  306,  305,  310,  310,
+    },
+    // rook
+    {
+         514,  508,  512,  483,  516,  512,  535,  529,
+         534,  508,  535,  546,  534,  541,  513,  539,
+         498,  514,  507,  512,  524,  506,  504,  494,
+         479,  484,  495,  492,  497,  475,  470,  473,
+         451,  444,  463,  458,  466,  450,  433,  449,
+         437,  451,  437,  454,  454,  444,  453,  433,
+         426,  441,  448,  453,  450,  436,  435,  426,
+         449,  455,  461,  484,  477,  461,  448,  447,
+    },
+    // queen
+    {
+         935,  930,  921,  825,  998,  953, 1017,  955,
+         943,  961,  989,  919,  949, 1005,  986,  953,
+         927,  972,  961,  989, 1001,  992,  972,  931,
+         930,  913,  951,  946,  954,  949,  916,  923,
+         915,  914,  927,  924,  928,  919,  909,  907,
+         899,  923,  916,  918,  913,  918,  913,  902,
+         893,  911,  929,  910,  914,  914,  908,  891,
+         890,  899,  898,  916,  898,  893,  895,  887,
+    },
+    // king
+    {
+        60004, 60054, 60047, 59901, 59901, 60060, 60083, 59938,
+        59968, 60010, 60055, 60056, 60056, 60055, 60010, 60003,
+        59938, 60012, 59943, 60044, 59933, 60028, 60037, 59969,
+        59945, 60050, 60011, 59996, 59981, 60013, 60000, 59951,
+        59945, 59957, 59948, 59972, 59949, 59953, 59992, 59950,
+        59953, 59958, 59957, 59921, 59936, 59968, 59971, 59968,
+        59996, 60003, 59986, 59950, 59943, 59982, 60013, 60004,
+        60017, 60030, 59997, 59986, 60006, 59999, 60040, 60018,
+    },
+    {}, // none
+    // clang-format on
+};
+
+inline constexpr int PST_EG[PT_COUNT][SQ_COUNT] = {
+    // clang-format off
+    // pawn
+    {
+         100,  100,  100,  100,  100,  100,  100,  100,
+         278,  273,  258,  234,  247,  232,  265,  287,
+         194,  200,  185,  167,  156,  153,  182,  184,
+         132,  124,  113,  105,   98,  104,  117,  117,
+         113,  109,   97,   93,   93,   92,  103,   99,
+         104,  107,   94,  101,  100,   95,   99,   92,
+         113,  108,  108,  110,  113,  100,  102,   93,
+         100,  100,  100,  100,  100,  100,  100,  100,
+    },
+    // knight
+    {
+         222,  242,  267,  252,  249,  253,  217,  181,
+         255,  272,  255,  278,  271,  255,  256,  228,
+         256,  260,  290,  289,  279,  271,  261,  239,
+         263,  283,  302,  302,  302,  291,  288,  262,
+         262,  274,  296,  305,  296,  297,  284,  262,
+         257,  277,  279,  295,  290,  277,  260,  258,
+         238,  260,  270,  275,  278,  260,  257,  236,
+         251,  229,  257,  265,  258,  262,  230,  216,
+    },
+    // bishop
+    {
+         306,  299,  309,  312,  313,  311,  303,  296,
+         312,  316,  327,  308,  317,  307,  316,  306,
+         322,  312,  320,  319,  318,  326,  320,  324,
+         317,  329,  332,  329,  334,  330,  323,  322,
+         314,  323,  333,  339,  327,  330,  317,  311,
+         308,  317,  328,  330,  333,  323,  313,  305,
+         306,  302,  313,  319,  324,  311,  305,  293,
+         297,  311,  297,  315,  311,  304,  315,  303,
+    },
+    // rook
+    {
+         492,  489,  497,  494,  491,  491,  487,  484,
+         490,  492,  492,  490,  476,  482,  487,  482,
+         486,  486,  486,  484,  483,  476,  474,  476,
+         483,  482,  492,  480,  481,  480,  478,  481,
+         482,  484,  487,  483,  474,  473,  471,  468,
+         475,  479,  474,  478,  472,  467,  471,  463,
+         473,  473,  479,  481,  470,  470,  468,  476,
+         470,  481,  482,  478,  474,  466,  483,  459,
+    },
+    // queen
+    {
+         920,  951,  951,  956,  956,  948,  939,  949,
+         912,  949,  961,  970,  987,  954,  959,  929,
+         909,  935,  938,  978,  976,  964,  948,  938,
+         932,  951,  953,  974,  986,  969,  986,  965,
+         911,  957,  948,  976,  960,  963,  968,  952,
+         913,  902,  944,  935,  938,  946,  939,  934,
+         907,  906,  899,  913,  913,  906,  893,  897,
+         896,  901,  907,  886,  924,  897,  909,  888,
+    },
+    // king
+    {
+        59926, 59965, 59982, 59982, 59989, 60015, 60004, 59983,
+        59988, 60017, 60014, 60017, 60017, 60038, 60023, 60011,
+        60010, 60017, 60023, 60015, 60020, 60045, 60044, 60013,
+        59992, 60022, 60024, 60027, 60026, 60033, 60026, 60003,
+        59982, 59996, 60021, 60024, 60027, 60023, 60009, 59989,
+        59981, 59997, 60011, 60021, 60023, 60016, 60007, 59991,
+        59973, 59989, 60004, 60013, 60014, 60004, 59995, 59983,
+        59947, 59966, 59979, 59989, 59972, 59986, 59976, 59957,
+    },
+    {}, // none
+    // clang-format on
+};
+
+#endif // !KINGFISH_PIECES_H
@@ -1,18 +1,90 @@
 #include "./position.h"
 
 #include <algorithm>
-#include <array>
+#include <cassert>
 #include <cctype>
-#include <cstring>
+#include <cstdlib>
 #include <iostream>
+#include <sstream>
 #include <string>
-#include <utility>
-#include <vector>
 
+#include "bitboard.h"
+#include "bits.h"
 #include "consts.h"
 #include "move.h"
+#include "pieces.h"
 #include "zobrist.h"
-#include "bitboard.h"
+
+// castling rights that survive a move touching the square
+static constexpr ui8 CASTLING_MASK[SQ_COUNT] = {
+    // clang-format off
+    CR_ALL ^ CR_BLACK_OOO, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL ^ (CR_BLACK_OO | CR_BLACK_OOO), CR_ALL, CR_ALL, CR_ALL ^ CR_BLACK_OO,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL ^ CR_WHITE_OOO, CR_ALL, CR_ALL, CR_ALL,
+    CR_ALL ^ (CR_WHITE_OO | CR_WHITE_OOO), CR_ALL, CR_ALL, CR_ALL ^ CR_WHITE_OO,
+    // clang-format on
+};
+
+// the tables are seen from white, black's pieces use them rotated
+static inline Square pstSquare(Color color, Square square) {
+    return color == CL_WHITE ? square : 63 - square;
+}
+
+Position::Position() {
+    for (Square s = 0; s < SQ_COUNT; s++) {
+        this->board[s] = PIECE_NONE;
+    }
+}
+
+Position Position::fromFen(const std::string &fen) {
+    Position pos;
+
+    std::istringstream ss(fen);
+    std::string        placement, turn, castling, ep;
+    int                rule50 = 0;
+    ss >> placement >> turn >> castling >> ep >> rule50;
+
+    Square square = SQ_A8;
+    for (char c : placement) {
+        if (c == '/') {
+            continue;
+        }
+        if (std::isdigit(c)) {
+            square += c - '0';
+        } else if (square < SQ_COUNT) {
+            pos.setPieceAt(square++, Piece::fromIdentifier(c));
+        }
+    }
+
+    pos.turn = turn == "b" ? CL_BLACK : CL_WHITE;
+
+    for (char c : castling) {
+        switch (c) {
+            case 'K': pos.castling_rights |= CR_WHITE_OO; break;
+            case 'Q': pos.castling_rights |= CR_WHITE_OOO; break;
+            case 'k': pos.castling_rights |= CR_BLACK_OO; break;
+            case 'q': pos.castling_rights |= CR_BLACK_OOO; break;
+            default: break;
+        }
+    }
+
+    if (ep.size() == 2) {
+        pos.ep = getSquare(ep[0] - 'a', ep[1] - '1');
+    }
+
+    pos.rule50 = std::clamp(rule50, 0, 255);
+
+    pos.key          = zobristHash(pos);
+    pos.pawn_key     = pawnHash(pos);
+    pos.material_key = materialHash(pos);
+    return pos;
+}
 
 void Position::printBBoards() const {
     for (Color c : {CL_WHITE, CL_BLACK}) {
@@ -25,283 +97,572 @@ void Position::printBBoards() const {
     }
 }
 
-Piece Position::getPieceAt(Square square) const {
-    if (!this->hasPieceAt(square)) {
-        return PIECE_NONE;
-    }
+std::string Position::toString() const {
+    std::string out;
 
-    for (Color c = CL_WHITE; c < CL_COUNT; c++) {
-        for (PieceType p = PT_PAWN; p < PT_COUNT; p++) {
-            if (get_bit(this->piece_bitboards[c][p], square)) {
-                return Piece(c, p);
-            }
+    for (Square s = 0; s < SQ_COUNT; s++) {
+        if (getFile(s) == FL_A) {
+            out += getRankIdentifier(getRank(s));
+            out += ' ';
         }
+        out += this->board[s].getIdentifier();
+        out += getFile(s) == FL_H ? '\n' : ' ';
     }
+    out += "  a b c d e f g h\n";
 
-    return PIECE_NONE;
+    return out;
 }
 
-bool Position::hasPieceAt(Square square) const {
-    for (Color c = CL_WHITE; c < CL_COUNT; c++) {
-        for (PieceType p = PT_PAWN; p < PT_COUNT; p++) {
-            if (get_bit(this->piece_bitboards[c][p], square)) {
-                return true;
-            }
-        }
-    }
+Square Position::kingSquare(Color c) const {
+    return bits::bitScanF(this->piece_bitboards[c][PT_KING]);
+}
 
-    return false;
+bool Position::canCaptureEp() const {
+    return this->ep != SQ_INVALID &&
+           (BBS::pawnAttacks(getOppositeColor(this->turn), this->ep) &
+            this->pieces(this->turn, PT_PAWN));
 }
 
 void Position::setPieceAt(Square square, Piece piece) {
     this->popPieceAt(square);
-    set_bit(this->piece_bitboards[piece.getColor()][piece.getType()], square);
+
+    Bitboard &bb = this->piece_bitboards[piece.getColor()][piece.getType()];
+    set_bit(bb, square);
+    set_bit(this->occupied_bitboards[piece.getColor()], square);
+    this->board[square] = piece;
+    this->key ^= pieceKey(piece, square);
+    if (piece.getType() == PT_PAWN) {
+        this->pawn_key ^= pieceKey(piece, square);
+    }
+    this->material_key ^= materialKey(piece, bits::popcount(bb) - 1);
+
+    int    sign = piece.getColor() == CL_WHITE ? 1 : -1;
+    Square rel  = pstSquare(piece.getColor(), square);
+    this->psq_mg += sign * PST_MG[piece.getType()][rel];
+    this->psq_eg += sign * PST_EG[piece.getType()][rel];
+    this->phase += PHASE_WEIGHTS[piece.getType()];
 }
 
 void Position::popPieceAt(Square square) {
-    for (Color c = CL_WHITE; c < CL_COUNT; c++) {
-        for (PieceType p = PT_PAWN; p < PT_COUNT; p++) {
-            pop_bit(this->piece_bitboards[c][p], square);
-        }
+    Piece piece = this->board[square];
+    if (piece == PIECE_NONE) {
+        return;
     }
+
+    Bitboard &bb = this->piece_bitboards[piece.getColor()][piece.getType()];
+    this->material_key ^= materialKey(piece, bits::popcount(bb) - 1);
+    pop_bit(bb, square);
+    pop_bit(this->occupied_bitboards[piece.getColor()], square);
+    this->board[square] = PIECE_NONE;
+    this->key ^= pieceKey(piece, square);
+    if (piece.getType() == PT_PAWN) {
+        this->pawn_key ^= pieceKey(piece, square);
+    }
+
+    int    sign = piece.getColor() == CL_WHITE ? 1 : -1;
+    Square rel  = pstSquare(piece.getColor(), square);
+    this->psq_mg -= sign * PST_MG[piece.getType()][rel];
+    this->psq_eg -= sign * PST_EG[piece.getType()][rel];
+    this->phase -= PHASE_WEIGHTS[piece.getType()];
 }
 
-std::vector<Move> Position::genMoves(bool check_king) const {
-    std::vector<Move> moves;
-    for (int i = 0; i < (int)board.size(); i++) {
-        char p = this->board[i];
+Bitboard Position::attackersTo(Square square, Bitboard occ) const {
+    Bitboard queens  = pieces(CL_WHITE, PT_QUEEN) | pieces(CL_BLACK, PT_QUEEN);
+    Bitboard bishops = pieces(CL_WHITE, PT_BISHOP) |
+                       pieces(CL_BLACK, PT_BISHOP) | queens;
+    Bitboard rooks =
+        pieces(CL_WHITE, PT_ROOK) | pieces(CL_BLACK, PT_ROOK) | queens;
+
+    return (BBS::pawnAttacks(CL_BLACK, square) & pieces(CL_WHITE, PT_PAWN)) |
+           (BBS::pawnAttacks(CL_WHITE, square) & pieces(CL_BLACK, PT_PAWN)) |
+           (BBS::knightAttacks(square) &
+            (pieces(CL_WHITE, PT_KNIGHT) | pieces(CL_BLACK, PT_KNIGHT))) |
+           (BBS::kingAttacks(square) &
+            (pieces(CL_WHITE, PT_KING) | pieces(CL_BLACK, PT_KING))) |
+           (BBS::bishopAttacks(square, occ) & bishops) |
+           (BBS::rookAttacks(square, occ) & rooks);
+}
 
-        if (!std::isupper(p)) {
+// the least valuable of the side's attackers, removed from occ, with the
+// sliders behind it that now see the square added to attackers
+static PieceType popLeastValuable(const Position &pos,
+                                  Square          square,
+                                  Color           side,
+                                  Bitboard       &attackers,
+                                  Bitboard       &occ) {
+    Bitboard mine = attackers & pos.occupied_bitboards[side];
+    for (PieceType pt = PT_PAWN; pt <= PT_KING; pt++) {
+        Bitboard candidates = mine & pos.pieces(side, pt);
+        if (!candidates) {
             continue;
         }
 
-        for (int d : DIRECTIONS[p]) {
-            for (int j = i + d;; j += d) {
-                char q = this->board[j];
-                if (std::isspace(q) || std::isupper(q)) {
-                    break;
-                }
-                if (p == 'P') {
-                    if ((d == DIR_NORTH || d == DIR_NORTH + DIR_NORTH) &&
-                        q != '.') {
-                        break;
-                    }
-                    if (d == DIR_NORTH + DIR_NORTH) {
-                        if (i < A1 + DIR_NORTH ||
-                            this->board[i + DIR_NORTH] != '.')
-                            break;
-                    }
-                    if (d == DIR_NORTH + DIR_WEST ||
-                        d == DIR_NORTH + DIR_EAST) {
-                        if (q == '.' && j != ep && j != kp && j != kp - 1 &&
-                            j != kp + 1)
-                            break;
-                    }
-                    if (A8 <= j && j <= H8) {
-                        for (char prom : {'N', 'B', 'R', 'Q'}) {
-                            if (check_king) {
-                                if (this->isValidMove(Move(i, j, prom))) {
-                                    moves.push_back(Move(i, j, prom));
-                                }
-                            } else {
-                                moves.push_back(Move(i, j, prom));
-                            }
-                        }
-                        break;
-                    }
-                }
-                if (check_king) {
-                    if (this->isValidMove(Move(i, j, ' '))) {
-                        moves.push_back(Move(i, j, ' '));
-                    }
-                } else {
-                    moves.push_back(Move(i, j, ' '));
-                }
-
-                if (p == 'P' || p == 'N' || p == 'K' || std::islower(q)) {
-                    break;
-                }
-
-                if (i == A1 && this->board[j + DIR_EAST] == 'K' &&
-                    this->wc.first) {
-                    moves.push_back(Move(j + DIR_EAST, j + DIR_WEST, ' '));
-                }
-                if (i == H1 && this->board[j + DIR_WEST] == 'K' &&
-                    this->wc.second) {
-                    moves.push_back(Move(j + DIR_WEST, j + DIR_EAST, ' '));
-                }
-            }
+        occ ^= candidates & -candidates;
+
+        Bitboard queens = pos.pieces(CL_WHITE, PT_QUEEN) |
+                          pos.pieces(CL_BLACK, PT_QUEEN);
+        if (pt == PT_PAWN || pt == PT_BISHOP || pt == PT_QUEEN) {
+            attackers |= BBS::bishopAttacks(square, occ) &
+                         (pos.pieces(CL_WHITE, PT_BISHOP) |
+                          pos.pieces(CL_BLACK, PT_BISHOP) | queens);
+        }
+        if (pt == PT_ROOK || pt == PT_QUEEN) {
+            attackers |= BBS::rookAttacks(square, occ) &
+                         (pos.pieces(CL_WHITE, PT_ROOK) |
+                          pos.pieces(CL_BLACK, PT_ROOK) | queens);
         }
+        attackers &= occ;
+
+        return pt;
     }
 
-    return moves;
+    return PT_NONE;
 }
 
-Position Position::rotate(bool nullmove) const {
-    std::string rotated_board(board.rbegin(), board.rend());
-    std::transform(rotated_board.begin(),
-                   rotated_board.end(),
-                   rotated_board.begin(),
-                   [](char c) {
-                       return std::islower(c) ? std::toupper(c)
-                                              : std::tolower(c);
-                   });
-    return Position(rotated_board,
-                    -score,
-                    wc,
-                    bc,
-                    (ep && !nullmove) ? 119 - ep : 0,
-                    (kp && !nullmove) ? 119 - kp : 0);
+// the piece a move takes, a pawn for en passant
+static PieceType capturedType(const Position &pos, const Move &move) {
+    PieceType victim = pos.board[move.to()].getType();
+    if (victim == PT_NONE && pos.isCapture(move)) {
+        victim = PT_PAWN;
+    }
+    return victim;
 }
 
-Position Position::move(const Move &move) const {
-    int  i = move.i, j = move.j;
-    char prom = move.prom;
-    char p    = board[i];
+// the occupancy once the move is made, without moving anything onto the
+// target square, where the exchange goes on
+static Bitboard occupiedAfter(const Position &pos, const Move &move) {
+    Bitboard occ = pos.occupied() ^ BIT(move.from());
+    if (move.to() == pos.ep &&
+        pos.board[move.from()].getType() == PT_PAWN) {
+        occ ^= BIT(move.to() + (pos.turn == CL_WHITE ? 8 : -8));
+    }
+    return occ;
+}
 
-    auto put = [](std::string b, int i, char p) -> std::string {
-        b[i] = p;
-        return b;
-    };
+int Position::see(const Move &move) const {
+    // the swap list, gain[d] is what the side making capture d has won if
+    // the exchange stops after it, each one stored before it is known
+    // whether that side has a piece left to capture with
+    int gain[32];
+    int d = 0;
 
-    std::string new_board = put(std::string(board), j, board[i]);
-    new_board             = put(new_board, i, '.');
-    int new_score         = score + value(move);
+    Square    to        = move.to();
+    PieceType on_square = this->board[move.from()].getType();
 
-    std::pair<bool, bool> new_wc = this->wc;
-    std::pair<bool, bool> new_bc = this->bc;
+    gain[0] = SEE_VALUES[capturedType(*this, move)];
+    if (move.isPromotion()) {
+        on_square = move.promotion();
+        gain[0] += SEE_VALUES[on_square] - SEE_VALUES[PT_PAWN];
+    }
 
-    int new_kp = 0, new_ep = 0;
+    Bitboard occ       = occupiedAfter(*this, move);
+    Bitboard attackers = this->attackersTo(to, occ) & occ;
+    Color    side      = getOppositeColor(this->turn);
 
-    if (i == A1) {
-        new_wc = {false, wc.second};
+    while (d < 31) {
+        d++;
+        gain[d] = SEE_VALUES[on_square] - gain[d - 1];
+
+        Bitboard  before = attackers;
+        PieceType pt = popLeastValuable(*this, to, side, attackers, occ);
+        if (pt == PT_NONE) {
+            break;
+        }
+
+        // the king only takes when nothing can take it back
+        if (pt == PT_KING &&
+            (before & this->occupied_bitboards[getOppositeColor(side)])) {
+            break;
+        }
+
+        on_square = pt;
+        side      = getOppositeColor(side);
     }
-    if (i == H1) {
-        new_wc = {wc.first, false};
+
+    while (--d > 0) {
+        gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
     }
-    if (j == A8) {
-        new_bc = {bc.first, false};
+
+    return gain[0];
+}
+
+bool Position::seeGe(const Move &move, int threshold) const {
+    // whether see(move) >= threshold, without building the whole swap list,
+    // by stopping as soon as one side can't go below or above it anymore
+    if (move.isPromotion()) {
+        return this->see(move) >= threshold;
     }
-    if (j == H8) {
-        new_bc = {false, bc.second};
+
+    int swap = SEE_VALUES[capturedType(*this, move)] - threshold;
+    if (swap < 0) {
+        return false;
     }
 
-    if (p == 'K') {
-        new_wc = {false, false};
+    swap = SEE_VALUES[this->board[move.from()].getType()] - swap;
+    if (swap <= 0) {
+        return true;
+    }
+
+    Square   to        = move.to();
+    Bitboard occ       = occupiedAfter(*this, move);
+    Bitboard attackers = this->attackersTo(to, occ) & occ;
+    Color    side      = this->turn;
+    bool     result    = true;
+
+    while (true) {
+        side = getOppositeColor(side);
+
+        Bitboard  before = attackers;
+        PieceType pt = popLeastValuable(*this, to, side, attackers, occ);
+        if (pt == PT_NONE) {
+            break;
+        }
+
+        // taking with the king is only possible if nothing can take back,
+        // then it decides the exchange
+        if (pt == PT_KING) {
+            if (before & this->occupied_bitboards[getOppositeColor(side)]) {
+                break;
+            }
+            return !result;
+        }
 
-        if (std::abs(j - i) == 2) {
-            new_kp    = (i + j) / 2;
-            new_board = put(std::string(new_board), j < i ? A1 : H1, '.');
-            new_board = put(std::string(new_board), new_kp, 'R');
+        result = !result;
+        swap   = SEE_VALUES[pt] - swap;
+        if (swap < int(result)) {
+            break;
         }
     }
 
-    if (p == 'P') {
-        if (A8 <= j && j <= H8) {
-            new_board = put(new_board, j, prom);
+    return result;
+}
+
+bool Position::isSquareAttacked(Square square, Color by) const {
+    return this->attackersTo(square, this->occupied()) &
+           this->occupied_bitboards[by];
+}
+
+Bitboard Position::pinnedPieces(Color c) const {
+    Color    them = getOppositeColor(c);
+    Square   king = this->kingSquare(c);
+    Bitboard occ  = this->occupied();
+
+    // enemy sliders that would see the king through exactly one piece
+    Bitboard snipers =
+        (BBS::rookAttacks(king, 0) &
+         (pieces(them, PT_ROOK) | pieces(them, PT_QUEEN))) |
+        (BBS::bishopAttacks(king, 0) &
+         (pieces(them, PT_BISHOP) | pieces(them, PT_QUEEN)));
+
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard between = BBS::betweenBB(king, bits::popLsb(snipers)) & occ;
+        if (between && !(between & (between - 1))) {
+            pinned |= between & this->occupied_bitboards[c];
         }
-        if (j - i == 2 * DIR_NORTH) {
-            new_ep = i + DIR_NORTH;
+    }
+
+    return pinned;
+}
+
+MoveList Position::genMoves(GenType type) const {
+    MoveList moves;
+    generateMoves(*this, type, moves);
+    return moves;
+}
+
+void Position::makeMove(const Move &move, Status &status) {
+    Square i = move.from(), j = move.to();
+    Piece  p  = this->board[i];
+    Color  us = this->turn;
+
+    status.last_move       = move;
+    status.captured        = this->board[j];
+    status.castling_rights = this->castling_rights;
+    status.ep              = this->ep;
+    status.rule50          = this->rule50;
+    status.key             = this->key;
+
+    if (this->canCaptureEp()) {
+        this->key ^= epKey(this->ep);
+    }
+
+    ui8 rights = this->castling_rights & CASTLING_MASK[i] & CASTLING_MASK[j];
+    this->key ^= castlingKey(this->castling_rights ^ rights);
+
+    this->ep              = SQ_INVALID;
+    this->castling_rights = rights;
+
+    if (p.getType() == PT_PAWN || status.captured != PIECE_NONE) {
+        this->rule50 = 0;
+    } else if (this->rule50 < 255) {
+        this->rule50++;
+    }
+
+    this->popPieceAt(i);
+    this->setPieceAt(j, p);
+
+    if (p.getType() == PT_KING && std::abs(j - i) == 2) {
+        // castling, bring the rook over to the other side of the king
+        Square rook_from = j > i ? j + 1 : j - 2;
+        Square rook_to   = (i + j) / 2;
+
+        this->popPieceAt(rook_from);
+        this->setPieceAt(rook_to, Piece(us, PT_ROOK));
+    }
+
+    if (p.getType() == PT_PAWN) {
+        if (move.isPromotion()) {
+            this->setPieceAt(j, Piece(us, move.promotion()));
         }
-        if (j == ep) {
-            new_board = put(std::string(new_board), j - DIR_SOUTH, '.');
+        if (std::abs(j - i) == 16) {
+            this->ep = (i + j) / 2;
         }
+        if (j == status.ep) {
+            this->popPieceAt(j + (us == CL_WHITE ? 8 : -8));
+        }
+    }
+
+    this->turn = getOppositeColor(us);
+    this->key ^= turnKey();
+
+    if (this->canCaptureEp()) {
+        this->key ^= epKey(this->ep);
     }
 
-    Position new_pos(new_board, new_score, new_wc, new_bc, new_ep, new_kp);
-    return new_pos.rotate();
+    assert(this->key == ui64(zobristHash(*this)));
+    assert(this->pawn_key == pawnHash(*this));
+    assert(this->material_key == materialHash(*this));
+    assert(this->eval() == this->value());
+}
+
+void Position::unmakeMove(const Move &move, const Status &status) {
+    Square i = move.from(), j = move.to();
+    Color  us = getOppositeColor(this->turn);
+    Piece  p  = move.isPromotion() ? Piece(us, PT_PAWN) : this->board[j];
+
+    this->popPieceAt(j);
+    this->setPieceAt(i, p);
+
+    if (status.captured != PIECE_NONE) {
+        this->setPieceAt(j, status.captured);
+    }
+
+    if (p.getType() == PT_KING && std::abs(j - i) == 2) {
+        Square rook_from = j > i ? j + 1 : j - 2;
+        Square rook_to   = (i + j) / 2;
+
+        this->popPieceAt(rook_to);
+        this->setPieceAt(rook_from, Piece(us, PT_ROOK));
+    }
+
+    if (p.getType() == PT_PAWN && j == status.ep) {
+        this->setPieceAt(j + (us == CL_WHITE ? 8 : -8),
+                         Piece(getOppositeColor(us), PT_PAWN));
+    }
+
+    this->turn            = us;
+    this->castling_rights = status.castling_rights;
+    this->ep              = status.ep;
+    this->rule50          = status.rule50;
+    this->key             = status.key;
+}
+
+void Position::makeNull(Status &status) {
+    status.last_move = NULLMOVE;
+    status.captured  = PIECE_NONE;
+    status.ep        = this->ep;
+    status.rule50    = this->rule50;
+    status.key       = this->key;
+
+    if (this->canCaptureEp()) {
+        this->key ^= epKey(this->ep);
+    }
+
+    // no repetition can reach back over a null move
+    this->ep     = SQ_INVALID;
+    this->rule50 = 0;
+    this->turn   = getOppositeColor(this->turn);
+    this->key ^= turnKey();
+
+    assert(this->key == ui64(zobristHash(*this)));
+}
+
+void Position::unmakeNull(const Status &status) {
+    this->ep     = status.ep;
+    this->rule50 = status.rule50;
+    this->turn   = getOppositeColor(this->turn);
+    this->key    = status.key;
+}
+
+Position Position::move(const Move &move) const {
+    Position pos(*this);
+    Status   status;
+
+    pos.makeMove(move, status);
+    return pos;
 }
 
 int Position::value(const Move &move) const {
-    int i = move.i;
-    int j = move.j;
+    // how much the move changes eval() for the side making it, at the phase
+    // before the move
+    Square i = move.from();
+    Square j = move.to();
 
-    char p = board[i];
-    char q = board[j];
+    Piece p = this->board[i];
+    Piece q = this->board[j];
 
-    if (p == '.') {
+    if (p == PIECE_NONE) {
         return -1;
     }
 
-    // std::cout << "p: " << p << " i: " << i<<" j: " <<j << std::endl;
-    int score =
-        PIECE_SQUARE_TABLES.at(p).at(j) - PIECE_SQUARE_TABLES.at(p).at(i);
+    Color     us   = this->turn;
+    Color     them = getOppositeColor(us);
+    PieceType pt   = p.getType();
+    Square    from = pstSquare(us, i), to = pstSquare(us, j);
 
-    // Capture
-    if (std::islower(q)) {
-        score += PIECE_SQUARE_TABLES[std::toupper(q)][119 - j];
-    }
+    int mg = PST_MG[pt][to] - PST_MG[pt][from];
+    int eg = PST_EG[pt][to] - PST_EG[pt][from];
 
-    // Castling check detection
-    if (abs(j - kp) < 2) {
-        score += PIECE_SQUARE_TABLES['K'][119 - j];
+    // Capture
+    if (q != PIECE_NONE) {
+        mg += PST_MG[q.getType()][pstSquare(them, j)];
+        eg += PST_EG[q.getType()][pstSquare(them, j)];
     }
 
     // Castling
-    if (p == 'K' && abs(i - j) == 2) {
-        score += PIECE_SQUARE_TABLES['R'][(i + j) / 2];
-        score -= PIECE_SQUARE_TABLES['R'][j < i ? A1 : H1];
+    if (pt == PT_KING && std::abs(i - j) == 2) {
+        Square rook_from = pstSquare(us, j > i ? j + 1 : j - 2);
+        Square rook_to   = pstSquare(us, (i + j) / 2);
+        mg += PST_MG[PT_ROOK][rook_to] - PST_MG[PT_ROOK][rook_from];
+        eg += PST_EG[PT_ROOK][rook_to] - PST_EG[PT_ROOK][rook_from];
     }
 
     // Special pawn stuff
-    if (p == 'P') {
-        if (A8 <= j && j <= H8) {
-            score += PIECE_SQUARE_TABLES.at(move.prom)[j] -
-                     PIECE_SQUARE_TABLES['P'][j];
+    if (pt == PT_PAWN) {
+        if (move.isPromotion()) {
+            mg += PST_MG[move.promotion()][to] - PST_MG[PT_PAWN][to];
+            eg += PST_EG[move.promotion()][to] - PST_EG[PT_PAWN][to];
         }
-        if (j == ep) {
-            score += PIECE_SQUARE_TABLES['P'][119 - (j + DIR_SOUTH)];
+        if (j == this->ep) {
+            Square captured = pstSquare(them, j + (us == CL_WHITE ? 8 : -8));
+            mg += PST_MG[PT_PAWN][captured];
+            eg += PST_EG[PT_PAWN][captured];
         }
     }
 
-    return score;
+    int phase = std::min<int>(this->phase, PHASE_MAX);
+    return (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
 }
 
 int Position::value() const {
-    int score = 0;
-
-    for (int i = H1; i <= A8; i++) {
-        char c = this->board[i];
+    // eval() from scratch, to check the incremental sums against
+    int mg = 0, eg = 0, phase = 0;
 
-        if (islower(c) || isspace(c) || c == '.') {
+    for (Square s = 0; s < SQ_COUNT; s++) {
+        Piece p = this->board[s];
+        if (p == PIECE_NONE) {
             continue;
         }
 
-        score += PIECE_SQUARE_TABLES[c][i];
+        int sign = p.getColor() == CL_WHITE ? 1 : -1;
+        mg += sign * PST_MG[p.getType()][pstSquare(p.getColor(), s)];
+        eg += sign * PST_EG[p.getType()][pstSquare(p.getColor(), s)];
+        phase += PHASE_WEIGHTS[p.getType()];
     }
 
-    return score;
+    phase     = std::min(phase, PHASE_MAX);
+    int score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+    return this->turn == CL_WHITE ? score : -score;
 }
 
 bool Position::isValidMove(const Move &move) const {
-    Position rotated = this->move(move);
-    if (rotated.rotate().isCheck()) {
+    Position moved = this->move(move);
+    return !moved.isSquareAttacked(moved.kingSquare(this->turn), moved.turn);
+}
+
+bool Position::isPseudoLegal(const Move &move) const {
+    // checks a move that did not come from the generator, such as a
+    // transposition table or killer move, against the current position
+    Square i = move.from(), j = move.to();
+    Piece  p = this->board[i];
+    Piece  q = this->board[j];
+
+    if (i == j || p == PIECE_NONE || p.getColor() != this->turn) {
+        return false;
+    }
+    if (q != PIECE_NONE &&
+        (q.getColor() == this->turn || q.getType() == PT_KING)) {
         return false;
     }
-    return true;
-}
 
-bool Position::isCheck() const {
-    Position          rotated = this->rotate();
-    std::vector<Move> moves   = rotated.genMoves(false);
+    bool last_rank = (1ULL << j) & (BBS::rank_8 | BBS::rank_1);
+    if (move.isPromotion() != (p.getType() == PT_PAWN && last_rank) ||
+        move.flags() > PT_QUEEN) {
+        return false;
+    }
 
-    return std::any_of(moves.cbegin(), moves.cend(), [&rotated](const Move &m) {
-        return rotated.board[m.j] == 'k';
-    });
-}
+    Bitboard occ  = this->occupied();
+    Bitboard to   = 1ULL << j;
+    Color    them = getOppositeColor(this->turn);
 
-bool Position::isCheckmate() const {
-    if (!this->isCheck()) { // cant be mated while not in check
+    switch (p.getType()) {
+        case PT_PAWN: {
+            int      push = this->turn == CL_WHITE ? -8 : 8;
+            Bitboard home = this->turn == CL_WHITE ? BBS::rank_2 : BBS::rank_7;
+
+            if (j == i + push) {
+                return q == PIECE_NONE;
+            }
+            if (j == i + 2 * push) {
+                return get_bit(home, i) && q == PIECE_NONE &&
+                       this->board[i + push] == PIECE_NONE;
+            }
+            return (BBS::pawnAttacks(this->turn, i) & to) &&
+                   (q != PIECE_NONE || j == this->ep);
+        }
+        case PT_KNIGHT: return BBS::knightAttacks(i) & to;
+        case PT_BISHOP: return BBS::bishopAttacks(i, occ) & to;
+        case PT_ROOK: return BBS::rookAttacks(i, occ) & to;
+        case PT_QUEEN: return BBS::queenAttacks(i, occ) & to;
+        default: break;
+    }
+
+    if (BBS::kingAttacks(i) & to) {
+        return true;
+    }
+
+    // castling, the landing square is left to isValidMove
+    Square start = this->turn == CL_WHITE ? SQ_E1 : SQ_E8;
+    bool   oo    = j == start + 2;
+    ui8    right = this->turn == CL_WHITE ? (oo ? CR_WHITE_OO : CR_WHITE_OOO)
+                                          : (oo ? CR_BLACK_OO : CR_BLACK_OOO);
+
+    Square rook = oo ? start + 3 : start - 4;
+    if (i != start || (j != start + 2 && j != start - 2) ||
+        !(this->castling_rights & right) ||
+        this->board[rook] != Piece(this->turn, PT_ROOK)) {
         return false;
     }
 
-    std::vector<Move> moves = this->rotate().genMoves(false);
+    Bitboard path = BBS::betweenBB(i, rook);
+    return !(path & occ) && !this->isSquareAttacked(i, them) &&
+           !this->isSquareAttacked((i + j) / 2, them);
+}
+
+bool Position::isLegal(const Move &move) const {
+    return this->isPseudoLegal(move) && this->isValidMove(move);
+}
 
-    return !std::any_of(moves.cbegin(), moves.cend(), [this](const Move &m) {
-        return !this->move(m).isCheck();
-    });
+bool Position::isCheck() const {
+    return this->isSquareAttacked(this->kingSquare(this->turn),
+                                  getOppositeColor(this->turn));
+}
+
+bool Position::isCheckmate() const {
+    return this->isCheck() && this->genMoves().empty();
 }
 
 PositionHash Position::hash() const {
-    return zobristHash(*this, true);
+    return static_cast<PositionHash>(this->key);
 }
@@ -1,97 +1,141 @@
 #ifndef POSITION_H_INCLUDED
 #define POSITION_H_INCLUDED
 
-#include <stack>
+#include <algorithm>
 #include <string>
-#include <vector>
+#include <type_traits>
 
 #include "move.h"
+#include "movegen.h"
 #include "piece.h"
+#include "pieces.h"
 #include "types.h"
 
-struct Status {
-    Color turn;
-    Move  last_move;
-    i64   zobrist_hash;
+// material values for static exchange evaluation, indexed by PieceType. a
+// king is never given up in an exchange, but taking one ends the game, so
+// that capture must never look like a losing one
+constexpr int SEE_VALUES[PT_COUNT] = {PIECE_VALUES[PT_PAWN],
+                                      PIECE_VALUES[PT_KNIGHT],
+                                      PIECE_VALUES[PT_BISHOP],
+                                      PIECE_VALUES[PT_ROOK],
+                                      PIECE_VALUES[PT_QUEEN],
+                                      PIECE_VALUES[PT_KING],
+                                      0};
+
+struct Status { // what makeMove needs to undo a move
+    Move   last_move;
+    Piece  captured;
+    ui8    castling_rights;
+    Square ep;
+    ui8    rule50;
+    ui64   key;
 };
 
-class Position { // Uses 40 bytes
+class Position { // Uses 232 bytes, see the static_assert below
   public:
     Bitboard piece_bitboards[CL_COUNT][PT_COUNT] = {};
     Bitboard occupied_bitboards[CL_COUNT]        = {};
 
-    CastlingRightsMask wc_rights;
-    CastlingRightsMask bc_rights;
-
-    Color turn = CL_WHITE;
-
-    std::string board; // 120 char representation of the board
-    int         score; // the board evaluation score
-
-    std::pair<bool, bool>
-        wc; // the castling rights, [west/queen side, east/king side]
-    std::pair<bool, bool>
-        bc; // the opponent rights, [west/king side, east/queen side]
-    int ep; // the en passant square
-    int kp; // the king passant square
-
-    Position(const std::string    &board,
-             int                   score,
-             std::pair<bool, bool> wc,
-             std::pair<bool, bool> bc,
-             int                   ep,
-             int                   kp)
-        : board(board)
-        , score(score)
-        , wc(wc)
-        , bc(bc)
-        , ep(ep)
-        , kp(kp) {}
+    Piece board[SQ_COUNT]; // mailbox, PIECE_NONE on empty squares
+
+    ui64 key          = 0; // zobrist key, updated along with every change
+    ui64 pawn_key     = 0; // the same of the pawns alone, see ai/pawns.h
+    ui64 material_key = 0; // of the piece counts alone, see endgame.h
+
+    // the piece-square sums, white's minus black's, and the game phase, kept
+    // up to date by setPieceAt and popPieceAt
+    int psq_mg = 0;
+    int psq_eg = 0;
+
+    Color  turn            = CL_WHITE;
+    ui8    castling_rights = CR_NONE;    // CastlingRightsMask bits
+    Square ep              = SQ_INVALID; // the en passant square
+    ui8    rule50          = 0; // plies since the last capture or pawn move
+    ui8    phase           = 0; // PHASE_WEIGHTS of the pieces on the board
+
+    Position();
+
+    static Position fromFen(const std::string &fen);
+
     inline bool operator==(const Position &other) const {
-        return board == other.board && score == other.score && wc == other.wc &&
-               bc == other.bc && ep == other.ep && kp == other.kp;
-    }
-    inline bool operator>(const Position &other) const {
-        if (score > other.score) {
-            return true;
-        } else if (score == other.score) {
-            return board > other.board;
-        } else {
-            return false;
+        for (Square s = 0; s < SQ_COUNT; s++) {
+            if (board[s] != other.board[s]) {
+                return false;
+            }
         }
+        return turn == other.turn && castling_rights == other.castling_rights &&
+               ep == other.ep;
     }
-    inline bool operator<(const Position &other) const {
-        if (score < other.score) {
-            return true;
-        } else if (score == other.score) {
-            return board < other.board;
-        } else {
-            return false;
-        }
+
+    inline Bitboard occupied() const {
+        return occupied_bitboards[CL_WHITE] | occupied_bitboards[CL_BLACK];
     }
+    inline Bitboard pieces(Color c, PieceType pt) const {
+        return piece_bitboards[c][pt];
+    }
+    inline bool hasNonPawnMaterial(Color c) const {
+        return piece_bitboards[c][PT_KNIGHT] | piece_bitboards[c][PT_BISHOP] |
+               piece_bitboards[c][PT_ROOK] | piece_bitboards[c][PT_QUEEN];
+    }
+    Square kingSquare(Color c) const;
+    bool   canCaptureEp() const;
 
-    std::vector<Move> genMoves(bool check_king = true) const;
+    MoveList genMoves(GenType type = GEN_ALL) const;
 
-    Piece getPieceAt(Square square) const;
-    bool  hasPieceAt(Square square) const;
-    void  popPieceAt(Square square);
-    void  setPieceAt(Square square, Piece p);
+    inline Piece getPieceAt(Square square) const { return board[square]; }
+    inline bool  hasPieceAt(Square square) const {
+        return board[square] != PIECE_NONE;
+    }
+    void popPieceAt(Square square);
+    void setPieceAt(Square square, Piece p);
+
+    Bitboard attackersTo(Square square, Bitboard occ) const;
+    Bitboard pinnedPieces(Color c) const;
+    bool     isSquareAttacked(Square square, Color by) const;
+    bool     isCheckmate() const;
+    bool     isCheck() const;
+    bool     isValidMove(const Move &move) const;
+    bool     isPseudoLegal(const Move &move) const;
+    bool     isLegal(const Move &move) const;
+
+    // static exchange evaluation of the captures on the move's target
+    // square, the material the side to move wins if both sides go on
+    // capturing there with their least valuable piece while it pays
+    int  see(const Move &move) const;
+    bool seeGe(const Move &move, int threshold) const;
+
+    inline bool isCapture(const Move &move) const {
+        return this->board[move.to()] != PIECE_NONE ||
+               (move.to() == this->ep &&
+                this->board[move.from()].getType() == PT_PAWN);
+    }
 
-    bool isCheckmate() const;
-    bool isCheck() const;
-    bool isValidMove(const Move &move) const;
+    void makeMove(const Move &move, Status &status);
+    void unmakeMove(const Move &move, const Status &status);
+    void makeNull(Status &status);
+    void unmakeNull(const Status &status);
 
     Position move(const Move &move) const;
-    Position rotate(bool nullmove = false) const;
+
+    // the evaluation for the side to move, the middlegame and endgame sums
+    // blended by how much material is left
+    inline int eval() const {
+        int phase = std::min<int>(this->phase, PHASE_MAX);
+        int score = (this->psq_mg * phase +
+                     this->psq_eg * (PHASE_MAX - phase)) /
+                    PHASE_MAX;
+        return this->turn == CL_WHITE ? score : -score;
+    }
 
     int          value(const Move &move) const;
     int          value() const;
     PositionHash hash() const;
 
-    void printBBoards() const;
-
-  private:
-    std::stack<Status> status_history;
+    std::string toString() const;
+    void        printBBoards() const;
 };
 
+static_assert(std::is_trivially_copyable_v<Position>);
+static_assert(sizeof(Position) == 232, "Position is copied per node");
+
 #endif // !POSITION_H_INCLUDED
@@ -124,7 +124,7 @@ enum Squares {
     SQ_A2, SQ_B2, SQ_C2, SQ_D2, SQ_E2, SQ_F2, SQ_G2, SQ_H2,
     SQ_A1, SQ_B1, SQ_C1, SQ_D1, SQ_E1, SQ_F1, SQ_G1, SQ_H1,
 
-    SQ_INVALID = SQ_H8 + 1,
+    SQ_INVALID = SQ_H1 + 1,
     SQ_COUNT   = 64
 };
 // clang-format on
@@ -161,11 +161,11 @@ inline constexpr BoardFile getFile(Square s) {
 }
 
 inline constexpr BoardRank getRank(Square s) {
-    return static_cast<BoardRank>(s / 8);
+    return static_cast<BoardRank>(RANK_8 - s / 8); // square 0 is a8
 }
 
 inline constexpr Square getSquare(BoardFile file, BoardRank rank) {
-    return static_cast<Square>(static_cast<int>(rank * 8) +
+    return static_cast<Square>(static_cast<int>((RANK_8 - rank) * 8) +
                                static_cast<int>(file));
 }
 
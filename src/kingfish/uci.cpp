@@ -6,39 +6,60 @@
 #include <thread>
 #include <vector>
 
-#include "./ai/searcher.h"
+#include "./ai/threadpool.h"
 #include "./ai/timemanager.h"
+#include "./ai/movepicker.h"
+#include "./ai/tablebases.h"
 #include "./clock.h"
 #include "./consts.h"
+#include "./options.h"
+#include "./perft.h"
+#include "./utils/alloccounter.h"
 #include "position.h"
 
-// TODO: create uci options dict, then export to make global
+Options options;
 
 int parse(const std::string &c) {
     // parses a string of algebraic notation (a1d4) into an integer
     int fil  = c[0] - 'a';
     int rank = int(c[1] - '0') - 1;
 
-    return A1 + fil - 10 * rank;
+    return getSquare(fil, rank);
 }
 
 std::string render(int i) {
     // renders a integer into algebraic notation
-    auto modulo = [](int dividend, int divisor) {
-        return (dividend % divisor + divisor) % divisor;
-    };
-    auto floor_division = [](int dividend, int divisor) {
-        int quotient = dividend / divisor;
-        if ((dividend < 0) != (divisor < 0) && (dividend % divisor) != 0) {
-            quotient--;
-        }
-        return quotient;
-    };
+    std::string out;
+    out += (char)(getFile(i) + 'a');
+    out += getRankIdentifier(getRank(i));
+
+    return out;
+}
+
+std::string renderMove(const Move &move) {
+    // renders a move into uci notation (e7e8q)
+    std::string out = render(move.from()) + render(move.to());
+    if (move.isPromotion()) {
+        out += PIECE_IDENTIFIER[CL_BLACK][move.promotion()];
+    }
 
-    int rank = floor_division((i - A1), 10);
-    int fil  = modulo((i - A1), 10);
+    return out;
+}
+
+Move parseUciMove(const std::string &str) {
+    // parses a move in uci notation (e7e8q), the inverse of renderMove
+    Square    from = parse(str.substr(0, 2));
+    Square    to   = parse(str.substr(2, 2));
+    PieceType prom = PT_NONE;
+
+    if (str.size() > 4) {
+        PieceType pt = Piece::fromIdentifier(str[4]).getType();
+        if (pt >= PT_KNIGHT && pt <= PT_QUEEN) {
+            prom = pt;
+        }
+    }
 
-    return (char)(fil + 'a') + std::to_string(-rank + 1);
+    return Move(from, to, prom);
 }
 
 void tokenize(const std::string        &str,
@@ -56,8 +77,6 @@ int uciMainLoop() {
     // TODO: commands to add
 
     // RECIEVING
-    // setoption name <id> [value <x>]
-    // position fen <fenstring>
 
     // go ponder
     // go searchmoves
@@ -81,93 +100,189 @@ int uciMainLoop() {
     // info sbhits <x>
     // info cpuload <x>
     // info currline <cpunr> <move1> ... <movei>
-    // option
-    // option name
-
     const char delim = ' ';
 
-    std::vector<Position> hist = {
-        Position(INITIAL, 0, {true, true}, {true, true}, 0, 0)};
-    Searcher searcher;
+    std::vector<Position> hist = {Position::fromFen(INITIAL)};
+    ThreadPool pool;
 
     for (std::string line; std::getline(std::cin, line);) {
         std::vector<std::string> args;
         tokenize(line, delim, args);
+        if (args.empty()) {
+            continue;
+        }
 
         if (args[0] == "uci") {
             std::cout << "id name " << VERSION << std::endl;
             std::cout << "id author Colin D" << std::endl;
+            options.printOptions();
             std::cout << "uciok" << std::endl;
         } else if (args[0] == "isready") {
             std::cout << "readyok" << std::endl;
         } else if (args[0] == "quit") {
             break;
-        } else if ((args[0] == "position" && args[1] == "startpos") ||
-                   args[0] == "ucinewgame") {
-            hist.clear();
-            hist = {Position(INITIAL, 0, {true, true}, {true, true}, 0, 0)};
-
-            if (args.size() > 2) {
-                for (int ply = 3; ply < (int)args.size(); ply++) {
-                    std::string move = args[ply];
+        } else if (args[0] == "setoption") {
+            // setoption name <id> [value <x>], both may contain spaces
+            std::string name, value, *part = nullptr;
+            for (std::size_t k = 1; k < args.size(); k++) {
+                if (args[k] == "name") {
+                    part = &name;
+                } else if (args[k] == "value") {
+                    part = &value;
+                } else if (part) {
+                    *part += (part->empty() ? "" : " ") + args[k];
+                }
+            }
 
-                    int i = parse(move.substr(0, 2));
-                    int j = parse(move.substr(2, 2));
+            if (!options.hasOption(name)) {
+                std::cout << "info string unknown option " << name
+                          << std::endl;
+            } else if (!options.setOptionValue(name, value)) {
+                std::cout << "info string invalid value '" << value
+                          << "' for option " << name << std::endl;
+            } else if (name == "Threads") {
+                pool.setThreads(options.getIntValue("Threads"));
+            } else if (name == "Hash") {
+                pool.resizeHash(options.getIntValue("Hash"));
+            } else if (name == "Clear Hash") {
+                pool.clearHash();
+            } else if (name == "EvalFile") {
+                pool.loadNetwork();
+            } else if (name == "SyzygyPath") {
+                Tablebases::init(options.getOptionValue("SyzygyPath"));
+            }
+        } else if (args[0] == "position" || args[0] == "ucinewgame") {
+            if (args[0] == "ucinewgame") {
+                pool.clearHash();
+                pool.clearHistory();
+            }
 
-                    std::string prom = move.substr(4);
-                    std::transform(
-                        prom.begin(), prom.end(), prom.begin(), ::toupper);
+            size_t ply = 2;
+            hist.clear();
 
-                    if (hist.size() % 2 == 0) {
-                        i = 119 - i, j = 119 - j;
-                    }
-                    Position to_add = hist.back().move(Move(i, j, prom[0]));
-                    hist.push_back(to_add);
+            if (args.size() > 1 && args[1] == "fen") {
+                std::string fen;
+                for (; ply < args.size() && args[ply] != "moves"; ply++) {
+                    fen += args[ply] + " ";
                 }
+                hist = {Position::fromFen(fen)};
+            } else {
+                hist = {Position::fromFen(INITIAL)};
+            }
+
+            for (ply++; ply < args.size(); ply++) {
+                Position to_add = hist.back().move(parseUciMove(args[ply]));
+                hist.push_back(to_add);
             }
         } else if (args[0] == "go") {
-            searcher.nodes_searched = 0;
             bool infinite =
                 std::find(args.begin(), args.end(), "infinite") != args.end();
 
             int ms_time = getSearchTime(args, hist);
 
             if (!infinite) {
-                 std::thread infinite_thread(
-                    std::mem_fn(&Searcher::searchTimed),
-                    &searcher,
+                std::thread infinite_thread(
+                    std::mem_fn(&ThreadPool::searchTimed),
+                    &pool,
                     std::ref(hist),
                     ms_time);
 
-                while (std::getline(std::cin, line) && line != "stop" && !searcher.stop_search) {
+                while (std::getline(std::cin, line) && line != "stop" && !pool.stop_search) {
                     // Keep reading input until the "stop" command is received. Or searcher stops the search
                 }
-                searcher.stopSearch();
+                pool.stopSearch();
                 infinite_thread.join();
             } else {
                 std::thread infinite_thread(
-                    std::mem_fn(&Searcher::searchInfinite),
-                    &searcher,
+                    std::mem_fn(&ThreadPool::searchInfinite),
+                    &pool,
                     std::ref(hist));
 
-                while (std::getline(std::cin, line) && line != "stop" && !searcher.stop_search) {
+                while (std::getline(std::cin, line) && line != "stop" && !pool.stop_search) {
                     // Keep reading input until the "stop" command is received.Or searcher stops the search
                 }
-                searcher.stopSearch();
+                pool.stopSearch();
                 infinite_thread.join();
             }
+        } else if (args[0] == "perft" || args[0] == "divide") {
+            // perft <depth> [threads], divide also lists each root move
+            int depth = 1, threads = 1;
+            if ((args.size() > 1 && !Options::parseInt(args[1], depth)) ||
+                (args.size() > 2 && !Options::parseInt(args[2], threads))) {
+                std::cout << "info string usage: " << args[0]
+                          << " <depth> [threads]" << std::endl;
+                continue;
+            }
+
+            PerftTable table;
+            TimePoint  start = Clock::now();
+
+            ui64 nodes = 0;
+            for (const auto &[move, count] :
+                 divide(hist.back(), std::max(depth, 1), threads, &table)) {
+                if (args[0] == "divide") {
+                    std::cout << renderMove(move) << ": " << count << std::endl;
+                }
+                nodes += count;
+            }
+
+            i64 ms = deltaMs(Clock::now(), start);
+            std::cout << "nodes " << nodes << " time " << ms << " nps "
+                      << nodes * 1000 / std::max<i64>(ms, 1) << std::endl;
         } else if (args[0] == "debug") {
             if (args.size() > 1) {
                 if (args[1] == "board") {
-                    std::cout << "board:\n" << hist.back().board << std::endl;
+                    std::cout << "board:\n" << hist.back().toString() << std::endl;
                 }
                 if (args[1] == "moves") {
                     std::cout << "moves: {";
-                    for (Move m : hist.back().genMoves(true)) {
-                        std::cout << render(m.i) + render(m.j) + m.prom;
+                    for (Move m : hist.back().genMoves()) {
+                        std::cout << " " << renderMove(m);
                     }
                     std::cout << "}" << std::endl;
                 }
+                if (args[1] == "allocs") {
+                    // walks every move and reply through the generator and
+                    // the move picker, none of which should allocate
+                    Position    pos    = hist.back();
+                    std::size_t before = allocationCount();
+
+                    Status     status;
+                    MovePicker picker(pos, NULLMOVE);
+                    for (Move m; picker.next(m);) {
+                        pos.makeMove(m, status);
+
+                        MovePicker replies(pos, NULLMOVE);
+                        for (Move r; replies.next(r);) {
+                        }
+
+                        pos.unmakeMove(m, status);
+                    }
+                    std::size_t movegen_allocs = allocationCount() - before;
+
+                    // then a depth 6 search, whose nodes keep their state
+                    // in the searcher's stack and shouldn't allocate either
+                    Searcher &searcher = *pool.searchers[0];
+                    searcher.setRoot(hist);
+                    searcher.nodes_searched = 0;
+
+                    pos    = searcher.root;
+                    before = allocationCount();
+                    searcher.bound(pos, 0, 6, 0, false);
+                    searcher.pvs(pos, -MATE_UPPER, MATE_UPPER, 6, 0, false);
+                    std::size_t search_allocs = allocationCount() - before;
+
+                    if (COUNTING_ALLOCATIONS) {
+                        std::cout << "allocations: " << movegen_allocs
+                                  << " search allocations: " << search_allocs
+                                  << " nodes " << searcher.nodes_searched
+                                  << std::endl;
+                    } else {
+                        std::cout << "allocations: not counted, build "
+                                     "without NDEBUG"
+                                  << std::endl;
+                    }
+                }
             }
         }
     }
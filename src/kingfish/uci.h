@@ -3,8 +3,12 @@
 
 #include <string>
 
+#include "move.h"
+
 int         parse(const std::string &c);
 std::string render(int i);
+std::string renderMove(const Move &move);
+Move        parseUciMove(const std::string &str);
 int         uciMainLoop();
 
 #endif //! KINGFISH_UCI_H
\ No newline at end of file
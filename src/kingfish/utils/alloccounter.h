@@ -0,0 +1,16 @@
+#ifndef ALLOCCOUNTER_H_INCLUDED
+#define ALLOCCOUNTER_H_INCLUDED
+
+#include <cstddef>
+
+// Builds without NDEBUG replace the global operator new with one that
+// counts its calls, so that hot paths can be checked to never allocate.
+#ifdef NDEBUG
+constexpr bool COUNTING_ALLOCATIONS = false;
+#else
+constexpr bool COUNTING_ALLOCATIONS = true;
+#endif
+
+std::size_t allocationCount();
+
+#endif
@@ -5,56 +5,79 @@
 #include <string>
 #include <unordered_map>
 
+#include "bits.h"
 #include "position.h"
-#include "uci.h"
 
-long long int zobristHash(const Position& pos, bool white_turn) {
+PositionHash zobristHash(const Position& pos) {
     // key=piece^castle^enpassant^turn;
-    long long int piece = 0;
-    int           index = -1;
+    ui64 key = 0;
 
-    for (char c : pos.board) {
-        index++;
-        if (isspace(c) || c == '.') {
-            continue;
-        }
+    for (Bitboard occ = pos.occupied(); occ;) {
+        Square square = bits::popLsb(occ);
+        key ^= pieceKey(pos.board[square], square);
+    }
+
+    // white can castle short     0
+    // white can castle long      1
+    // black can castle short     2
+    // black can castle long      3
+    key ^= castlingKey(pos.castling_rights);
 
-        std::string algebra_notation = render(index);
-        char        file             = algebra_notation[0];
-        char        row              = algebra_notation[1];
+    // the en passant file only counts when a pawn can actually capture
+    if (pos.canCaptureEp()) {
+        key ^= epKey(pos.ep);
+    }
 
-        piece ^= ZOBRIST_KEYS[getPieceOffset(c, file - 'a', row - '0')];
+    if (pos.turn == CL_WHITE) {
+        key ^= turnKey();
     }
 
-    return piece ^ ZOBRIST_KEYS[768 + encodeCastle(pos)] ^
-           ZOBRIST_KEYS[render(pos.ep)[0] - 'a'] ^
-           (white_turn ? ZOBRIST_KEYS[780] : 0);
+    return static_cast<PositionHash>(key);
 }
 
-long long int getPieceOffset(char piece, int row, int file) {
-    // offset_piece=64*kind_of_piece+8*row+file;
-    return KIND_OF_PIECE[piece] + 8 * row + file;
+ui64 pawnHash(const Position& pos) {
+    ui64 key = 0;
+
+    for (Color c : {CL_WHITE, CL_BLACK}) {
+        for (Bitboard pawns = pos.pieces(c, PT_PAWN); pawns;) {
+            Square square = bits::popLsb(pawns);
+            key ^= pieceKey(Piece(c, PT_PAWN), square);
+        }
+    }
+
+    return key;
 }
 
-int encodeCastle(const Position& pos) {
-    // white can castle short     0
-    // white can castle long      1
-    // black can castle short     2
-    // black can castle long      3
-    // If none of these flags apply then castle=0.
-    int out = 0;
-
-    if (pos.wc.first) {
-        out ^= 0;
-    } else if (pos.wc.second) {
-        out ^= 1;
-    } else if (pos.bc.first) {
-        out ^= 2;
-    } else if (pos.bc.second) {
-        out ^= 3;
+ui64 materialHash(const Position& pos) {
+    ui64 key = 0;
+
+    for (Color c : {CL_WHITE, CL_BLACK}) {
+        for (PieceType pt = PT_PAWN; pt <= PT_KING; pt++) {
+            int count = bits::popcount(pos.pieces(c, pt));
+            for (int n = 0; n < count; n++) {
+                key ^= materialKey(Piece(c, pt), n);
+            }
+        }
     }
 
-    return out;
+    return key;
+}
+
+ui64 materialHash(const std::string &code, Color first) {
+    const std::string PIECES = "PNBRQK";
+
+    ui64  key                        = 0;
+    int   counts[CL_COUNT][PT_COUNT] = {};
+    Color side                       = getOppositeColor(first);
+    for (char c : code) {
+        if (c == 'v') {
+            continue;
+        }
+        side   = c == 'K' ? getOppositeColor(side) : side;
+        int pt = int(PIECES.find(c));
+        key ^= materialKey(Piece(side, pt), counts[side][pt]++);
+    }
+    return key;
 }
 
 Book readBook(const std::string& filepath) {
@@ -104,18 +127,15 @@ bool getBestMove(Book* book, long long int hash, Move& move) {
 }
 
 Move parseMove(std::uint16_t* move_bytes) {
-    int starting_square = move_bytes[0];
-    int ending_square   = move_bytes[1];
+    // to file, to row, from file, from row, promotion piece; 3 bits each
+    std::uint16_t raw = *move_bytes;
 
-    int  promotion_piece = move_bytes[3];
-    char prom            = ' ';
+    Square to   = getSquare(raw & 7, (raw >> 3) & 7);
+    Square from = getSquare((raw >> 6) & 7, (raw >> 9) & 7);
 
-    for (std::pair<char, int> p : KIND_OF_PIECE) {
-        if (p.second == promotion_piece) {
-            prom = p.first;
-            break;
-        }
-    }
+    constexpr PieceType PROMOTIONS[] = {
+        PT_NONE, PT_KNIGHT, PT_BISHOP, PT_ROOK, PT_QUEEN};
+    PieceType prom = PROMOTIONS[((raw >> 12) & 7) % 5];
 
-    return Move(starting_square, ending_square, prom);
+    return Move(from, to, prom);
 }
@@ -4,6 +4,7 @@
 #define U64(u) (u##ULL)
 
 #include <unordered_map>
+#include <vector>
 
 #include "position.h"
 
@@ -279,22 +280,39 @@ const unsigned long long int ZOBRIST_KEYS[781] = {
 // RandomEnPassant (offset: 772, length:   8)
 // RandomTurn      (offset: 780, length:   1)
 
-static std::unordered_map<char, int> KIND_OF_PIECE = {{'p', 0},
-                                                      {'P', 1},
-                                                      {'n', 2},
-                                                      {'N', 3},
-                                                      {'b', 4},
-                                                      {'B', 5},
-                                                      {'r', 6},
-                                                      {'R', 7},
-                                                      {'q', 8},
-                                                      {'Q', 9},
-                                                      {'k', 10},
-                                                      {'K', 11}};
+PositionHash zobristHash(const Position &pos);
+ui64         pawnHash(const Position &pos); // the pawns' part of the key
+ui64         materialHash(const Position &pos); // of the piece counts
+// the same of pieces written as a code, first's side from its king on then
+// the other side's, "KRKP" or "KRvKP" for instance
+ui64 materialHash(const std::string &code, Color first);
 
-long long int zobristHash(const Position &pos, bool white_turn);
-long long int getPieceOffset(char piece, int row, int file);
-int           encodeCastle(const Position &pos);
+inline int getPieceOffset(Piece piece, Square square) {
+    // offset_piece=64*kind_of_piece+8*row+file;
+    int kind = 2 * piece.getType() + (piece.getColor() == CL_WHITE ? 1 : 0);
+    return 64 * kind + 8 * getRank(square) + getFile(square);
+}
+
+// the pieces of the key that Position updates incrementally
+inline ui64 pieceKey(Piece piece, Square square) {
+    return ZOBRIST_KEYS[getPieceOffset(piece, square)];
+}
+// the n-th piece of a kind (from 0) is keyed as if it stood on square n,
+// so the material key only depends on how many of each there are
+inline ui64 materialKey(Piece piece, int n) {
+    return pieceKey(piece, Square(n));
+}
+inline ui64 castlingKey(ui8 rights) {
+    ui64 key = 0;
+    for (int right = 0; right < 4; right++) {
+        if (rights & (1 << right)) {
+            key ^= ZOBRIST_KEYS[768 + right];
+        }
+    }
+    return key;
+}
+inline ui64 epKey(Square ep) { return ZOBRIST_KEYS[772 + getFile(ep)]; }
+inline ui64 turnKey() { return ZOBRIST_KEYS[780]; }
 
 struct BookMove {
     uint16_t move;
@@ -0,0 +1,179 @@
+// kingfish_nnue gen <file> [seed]
+// kingfish_nnue check <file> [depth]
+//
+// gen writes a network of random weights in the EvalFile format, for testing
+// only, it plays no better than chance. check walks every line of the perft
+// positions to depth, null moves included, and compares the accumulators
+// the search updates move by move with ones refreshed from scratch. exits
+// with 1 when any differ or the file can't be written or read.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../kingfish/ai/nnue.h"
+#include "../kingfish/bitboard.h"
+#include "../kingfish/position.h"
+
+// castling both ways, en passant, promotions with and without a capture
+static const char *CHECK_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+static bool generate(const std::string &path, ui64 seed) {
+    // xorshift64*, the same weights for a seed on every platform
+    ui64 state  = seed ? seed : 1;
+    auto random = [&state](int lo, int hi) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return lo + int((state * 0x2545F4914F6CDD1DULL >> 33) % (hi - lo + 1));
+    };
+    auto fill = [&random](std::size_t count, int lo, int hi) {
+        std::vector<i16> values(count);
+        for (i16 &v : values) {
+            v = i16(random(lo, hi));
+        }
+        return values;
+    };
+
+    // small enough that no accumulator can overflow
+    std::vector<i16> weights =
+        fill(std::size_t(NNUE_FEATURES) * NNUE_HIDDEN, -40, 40);
+    std::vector<i16> biases  = fill(NNUE_HIDDEN, 0, 60);
+    std::vector<i16> outputs = fill(2 * NNUE_HIDDEN, -64, 64);
+    i32              bias    = random(-100, 100);
+
+    std::ofstream file(path, std::ios::binary);
+    ui32 header[3] = {NNUE_VERSION, NNUE_HIDDEN, NNUE_FEATURES};
+    file.write("KFNN", 4);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const std::vector<i16> *values : {&weights, &biases, &outputs}) {
+        file.write(reinterpret_cast<const char *>(values->data()),
+                   std::streamsize(values->size() * sizeof(i16)));
+    }
+    file.write(reinterpret_cast<const char *>(&bias), sizeof(bias));
+    return bool(file);
+}
+
+static std::string render(const Move &move) {
+    if (move == NULLMOVE) {
+        return "0000";
+    }
+    std::string out;
+    for (Square sq : {move.from(), move.to()}) {
+        out += char('a' + (sq & 7));
+        out += char('8' - (sq >> 3));
+    }
+    if (move.isPromotion()) {
+        out += "pnbrqk"[move.promotion()];
+    }
+    return out;
+}
+
+struct Checker {
+    const Network           &network;
+    std::vector<Accumulator> stack; // by ply, updated from the one before
+    std::vector<Move>        line;  // from the root, to report a mismatch
+    const char              *fen        = nullptr;
+    ui64                     checked    = 0;
+    ui64                     mismatches = 0;
+
+    void check(const Position &pos, int ply) {
+        Accumulator fresh;
+        this->network.refresh(pos, fresh);
+        this->checked++;
+
+        if (std::memcmp(&fresh, &this->stack[ply], sizeof(fresh)) != 0 &&
+            this->mismatches++ < 10) {
+            std::cout << "FAIL " << this->fen << " moves";
+            for (int k = 0; k < ply; k++) {
+                std::cout << ' ' << render(this->line[k]);
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    void walk(Position &pos, int depth, int ply) {
+        if (depth == 0) {
+            return;
+        }
+
+        Status status;
+        for (const Move &move : pos.genMoves()) {
+            this->line[ply] = move;
+            pos.makeMove(move, status);
+            this->network.update(
+                pos, status, this->stack[ply], this->stack[ply + 1]);
+            this->check(pos, ply + 1);
+            this->walk(pos, depth - 1, ply + 1);
+            pos.unmakeMove(move, status);
+        }
+
+        if (!pos.isCheck()) {
+            this->line[ply] = NULLMOVE;
+            pos.makeNull(status);
+            this->network.update(
+                pos, status, this->stack[ply], this->stack[ply + 1]);
+            this->check(pos, ply + 1);
+            pos.unmakeNull(status);
+        }
+    }
+};
+
+static bool check(const std::string &path, int depth) {
+    Network network;
+    if (!network.load(path)) {
+        std::cout << "no network in " << path << std::endl;
+        return false;
+    }
+
+    Checker checker{network,
+                    std::vector<Accumulator>(depth + 1),
+                    std::vector<Move>(depth)};
+    for (const char *fen : CHECK_POSITIONS) {
+        Position pos = Position::fromFen(fen);
+        checker.fen  = fen;
+        network.refresh(pos, checker.stack[0]);
+        checker.walk(pos, depth, 0);
+    }
+
+    std::cout << (checker.mismatches ? "FAIL " : "ok   ") << checker.checked
+              << " positions, " << checker.mismatches << " mismatches, "
+              << simdName() << " kernels" << std::endl;
+    return !checker.mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    std::string command = argc > 1 ? argv[1] : "";
+    if (argc < 3 || (command != "gen" && command != "check")) {
+        std::cout << "usage: kingfish_nnue gen <file> [seed]\n"
+                     "       kingfish_nnue check <file> [depth]"
+                  << std::endl;
+        return 1;
+    }
+
+    BBS::initLeaperAttacks();
+    BBS::initSliderAttacks();
+    BBS::initLines();
+
+    if (command == "gen") {
+        ui64 seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+        if (!generate(argv[2], seed)) {
+            std::cout << "could not write " << argv[2] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    int depth = argc > 3 ? std::atoi(argv[3]) : 3;
+    return check(argv[2], std::max(depth, 1)) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// kingfish_perft [threads] [hash mb] [max depth]
+//
+// runs the standard perft suite and checks the node counts, then reports the
+// move generation speed. a max depth runs each position no deeper, for a
+// quick check. exits with 1 when any count is wrong.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "../kingfish/bitboard.h"
+#include "../kingfish/clock.h"
+#include "../kingfish/perft.h"
+#include "../kingfish/position.h"
+
+struct PerftCase {
+    const char *name;
+    const char *fen;
+    ui64        nodes[7]; // by depth from 1, the suite runs the deepest
+};
+
+// https://www.chessprogramming.org/Perft_Results
+static const PerftCase PERFT_SUITE[] = {
+    {"startpos",
+     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+     {20, 400, 8902, 197281, 4865609, 119060324}},
+    {"kiwipete",
+     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+     {48, 2039, 97862, 4085603, 193690690}},
+    {"position 3",
+     "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+     {14, 191, 2812, 43238, 674624, 11030083, 178633661}},
+    {"position 4",
+     "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+     {6, 264, 9467, 422333, 15833292}},
+    {"position 5",
+     "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+     {44, 1486, 62379, 2103487, 89941194}},
+    {"position 6",
+     "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+     {46, 2079, 89890, 3894594, 164075551}},
+};
+
+int main(int argc, char *argv[]) {
+    int         threads   = argc > 1 ? std::atoi(argv[1]) : 1;
+    std::size_t hash_mb   = argc > 2 ? std::atoi(argv[2]) : PERFT_HASH_MB;
+    int         max_depth = argc > 3 ? std::atoi(argv[3]) : 0;
+
+    BBS::initLeaperAttacks();
+    BBS::initSliderAttacks();
+    BBS::initLines();
+
+    PerftTable table(hash_mb);
+
+    bool failed      = false;
+    ui64 total_nodes = 0;
+    i64  total_ms    = 0;
+
+    for (const PerftCase &test : PERFT_SUITE) {
+        int depth = int(std::find(test.nodes, std::end(test.nodes), 0) -
+                        test.nodes);
+        if (max_depth > 0) {
+            depth = std::min(depth, max_depth);
+        }
+        ui64 expected = test.nodes[depth - 1];
+
+        Position  pos   = Position::fromFen(test.fen);
+        TimePoint start = Clock::now();
+
+        ui64 nodes = 0;
+        for (const auto &[move, count] :
+             divide(pos, depth, threads, hash_mb ? &table : nullptr)) {
+            nodes += count;
+        }
+
+        i64 ms = deltaMs(Clock::now(), start);
+        total_nodes += nodes;
+        total_ms += ms;
+
+        bool ok = nodes == expected;
+        failed |= !ok;
+
+        std::cout << (ok ? "ok   " : "FAIL ") << std::left << std::setw(12)
+                  << test.name << " depth " << depth << " nodes "
+                  << nodes;
+        if (!ok) {
+            std::cout << " expected " << expected;
+        }
+        std::cout << " time " << ms << " nps "
+                  << nodes * 1000 / std::max<i64>(ms, 1) << std::endl;
+    }
+
+    std::cout << "total nodes " << total_nodes << " time " << total_ms
+              << " nps " << total_nodes * 1000 / std::max<i64>(total_ms, 1)
+              << std::endl;
+
+    return failed ? 1 : 0;
+}
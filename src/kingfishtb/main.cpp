@@ -0,0 +1,1110 @@
+// kingfish_tb gen <dir>
+// kingfish_tb check <dir>
+//
+// gen solves the endings the tests probe, KBvK, KNvK, KQvK, KRvK, KPvK and
+// KNvKN, by retrograde analysis and writes their WDL and DTZ tables to dir
+// in the Syzygy format. check probes the tables in dir: every position of
+// the three piece endings against results it solves again, with either
+// colour as the stronger side, known positions of KNvKN, and the ranking
+// of root moves with and without repetitions. exits with 1 when any result
+// differs or a table can't be written or read.
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "../kingfish/ai/tablebases.h"
+#include "../kingfish/bitboard.h"
+#include "../kingfish/bits.h"
+#include "../kingfish/consts.h"
+#include "../kingfish/position.h"
+
+// Solving. A position is its pieces' squares, the board's with a8 = 0,
+// and the side to move, indexed densely as turn + 2 * (s0 + 64 * s1 ...).
+
+const int MAX_PIECES = 4;
+const i8  UNKNOWN    = -128;
+const i8  ILLEGAL    = 127; // pieces on one square, a pawn on the back
+                            // ranks, or the side not to move in check
+
+struct Placement {
+    int       count = 0;
+    Color     colors[MAX_PIECES] = {};
+    PieceType types[MAX_PIECES]  = {};
+    int       squares[MAX_PIECES] = {};
+    Color     turn                = CL_WHITE;
+};
+
+struct Ending {
+    std::string       name;   // white's pieces first, white the stronger
+    Placement         pieces; // the colours and types, in the tables' order
+    std::vector<i8>   wdl;    // by index, for the side to move
+    std::vector<ui8>  dtz;    // plies to a capture, pawn move or mate
+    std::vector<bool> mated;
+
+    std::size_t size() const {
+        return std::size_t(2) << (6 * this->pieces.count);
+    }
+};
+
+static std::map<std::string, Ending> endings;
+
+static std::size_t indexOf(const Placement &p) {
+    std::size_t idx = 0;
+    for (int i = p.count - 1; i >= 0; i--) {
+        idx = idx * 64 + p.squares[i];
+    }
+    return idx * 2 + p.turn;
+}
+
+static Placement placementAt(const Ending &e, std::size_t idx) {
+    Placement p = e.pieces;
+    p.turn      = Color(idx & 1);
+    idx >>= 1;
+    for (int i = 0; i < p.count; i++, idx >>= 6) {
+        p.squares[i] = int(idx & 63);
+    }
+    return p;
+}
+
+static Bitboard occupancy(const Placement &p, int color = -1) {
+    Bitboard b = 0;
+    for (int i = 0; i < p.count; i++) {
+        if (color < 0 || p.colors[i] == color) {
+            b |= BIT(p.squares[i]);
+        }
+    }
+    return b;
+}
+
+static Bitboard
+attacks(PieceType type, Color color, int square, Bitboard occupied) {
+    Square sq = Square(square);
+    switch (type) {
+    case PT_PAWN: return BBS::pawnAttacks(color, sq);
+    case PT_KNIGHT: return BBS::knightAttacks(sq);
+    case PT_BISHOP: return BBS::bishopAttacks(sq, occupied);
+    case PT_ROOK: return BBS::rookAttacks(sq, occupied);
+    case PT_QUEEN: return BBS::queenAttacks(sq, occupied);
+    default: return BBS::kingAttacks(sq);
+    }
+}
+
+static bool attacked(const Placement &p, int square, Color by) {
+    Bitboard occupied = occupancy(p);
+    for (int i = 0; i < p.count; i++) {
+        if (p.colors[i] == by &&
+            attacks(p.types[i], by, p.squares[i], occupied) & BIT(square)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int kingSquare(const Placement &p, Color color) {
+    for (int i = 0; i < p.count; i++) {
+        if (p.colors[i] == color && p.types[i] == PT_KING) {
+            return p.squares[i];
+        }
+    }
+    return -1;
+}
+
+static bool legal(const Placement &p) {
+    if (int(bits::popcount(occupancy(p))) != p.count) {
+        return false;
+    }
+    for (int i = 0; i < p.count; i++) {
+        int row = p.squares[i] >> 3;
+        if (p.types[i] == PT_PAWN && (row == 0 || row == 7)) {
+            return false;
+        }
+    }
+    Color them = Color(p.turn ^ 1);
+    return !attacked(p, kingSquare(p, them), p.turn);
+}
+
+// calls visit(child, zeroing, internal) for each legal move, internal
+// when the child has the same pieces, so no capture or promotion
+template <typename Visit>
+static void forEachMove(const Placement &p, Visit visit) {
+    Color    us = p.turn, them = Color(us ^ 1);
+    Bitboard own = occupancy(p, us), theirs = occupancy(p, them);
+    Bitboard occupied = own | theirs;
+
+    for (int i = 0; i < p.count; i++) {
+        if (p.colors[i] != us) {
+            continue;
+        }
+
+        int      from = p.squares[i];
+        bool     pawn = p.types[i] == PT_PAWN;
+        Bitboard targets;
+        if (pawn) {
+            int dir = us == CL_WHITE ? -8 : 8;
+            targets = attacks(PT_PAWN, us, from, occupied) & theirs;
+            if (!(occupied & BIT(from + dir))) {
+                targets |= BIT(from + dir);
+                int start = us == CL_WHITE ? 6 : 1;
+                if ((from >> 3) == start &&
+                    !(occupied & BIT(from + 2 * dir))) {
+                    targets |= BIT(from + 2 * dir);
+                }
+            }
+        } else {
+            targets = attacks(p.types[i], us, from, occupied) & ~own;
+        }
+
+        while (targets) {
+            int       to      = bits::popLsb(targets);
+            bool      capture = theirs & BIT(to);
+            Placement child   = p;
+            int       mover   = i;
+
+            child.turn           = them;
+            child.squares[mover] = to;
+            if (capture) {
+                int j = 0;
+                while (p.squares[j] != to) {
+                    j++;
+                }
+                std::copy(child.colors + j + 1,
+                          child.colors + child.count,
+                          child.colors + j);
+                std::copy(child.types + j + 1,
+                          child.types + child.count,
+                          child.types + j);
+                std::copy(child.squares + j + 1,
+                          child.squares + child.count,
+                          child.squares + j);
+                child.count--;
+                mover -= j < i;
+            }
+
+            if (attacked(child, kingSquare(child, us), them)) {
+                continue;
+            }
+
+            int last = us == CL_WHITE ? 0 : 7;
+            if (pawn && (to >> 3) == last) {
+                for (PieceType pt : {PT_QUEEN, PT_ROOK, PT_BISHOP, PT_KNIGHT}) {
+                    child.types[mover] = pt;
+                    visit(child, true, false);
+                }
+            } else {
+                visit(child, capture || pawn, !capture);
+            }
+        }
+    }
+}
+
+// calls visit(parent, pawn) for each legal position the side not to move
+// reaches p from with a move that neither captures nor promotes
+template <typename Visit>
+static void forEachUnmove(const Placement &p, Visit visit) {
+    Color    them     = Color(p.turn ^ 1);
+    Bitboard occupied = occupancy(p);
+
+    for (int i = 0; i < p.count; i++) {
+        if (p.colors[i] != them) {
+            continue;
+        }
+
+        int      to   = p.squares[i];
+        bool     pawn = p.types[i] == PT_PAWN;
+        Bitboard origins;
+        if (pawn) {
+            int dir  = them == CL_WHITE ? -8 : 8;
+            int from = to - dir, row = from >> 3;
+            origins  = 0;
+            if (row >= 1 && row <= 6 && !(occupied & BIT(from))) {
+                origins |= BIT(from);
+                int start = them == CL_WHITE ? 6 : 1;
+                if (((from - dir) >> 3) == start &&
+                    !(occupied & BIT(from - dir))) {
+                    origins |= BIT(from - dir);
+                }
+            }
+        } else {
+            origins = attacks(p.types[i], them, to, occupied) & ~occupied;
+        }
+
+        while (origins) {
+            Placement parent  = p;
+            parent.squares[i] = bits::popLsb(origins);
+            parent.turn       = them;
+            if (legal(parent)) {
+                visit(parent, pawn);
+            }
+        }
+    }
+}
+
+// the pieces of each side from the king down, "KRvKP", with the colours
+// swapped if swap
+static std::string materialName(const Placement &p, bool swap) {
+    const std::string PIECES = "PNBRQK";
+
+    std::string side[2];
+    for (PieceType pt = PT_KING; pt >= PT_PAWN; pt--) {
+        for (int i = 0; i < p.count; i++) {
+            if (p.types[i] == pt) {
+                side[p.colors[i] ^ swap] += PIECES[pt];
+            }
+        }
+    }
+    return side[0] + 'v' + side[1];
+}
+
+// the ending and the position in it of pieces after a capture or
+// promotion, with the colours swapped when black is the stronger side
+static const Ending *solvedEnding(const Placement &p, std::size_t &idx) {
+    for (bool swap : {false, true}) {
+        auto found = endings.find(materialName(p, swap));
+        if (found == endings.end() || found->second.wdl.empty()) {
+            continue;
+        }
+
+        const Ending &e    = found->second;
+        Placement     q    = e.pieces;
+        bool          used[MAX_PIECES] = {};
+        q.turn = Color(p.turn ^ swap);
+        for (int i = 0; i < q.count; i++) {
+            for (int j = 0; j < p.count; j++) {
+                if (!used[j] && (p.colors[j] ^ swap) == q.colors[i] &&
+                    p.types[j] == q.types[i]) {
+                    q.squares[i] = swap ? p.squares[j] ^ 56 : p.squares[j];
+                    used[j]      = true;
+                    break;
+                }
+            }
+        }
+        idx = indexOf(q);
+        return &e;
+    }
+    return nullptr;
+}
+
+static i8 solvedWdl(const Placement &p) {
+    if (p.count == 2) {
+        return 0;
+    }
+    std::size_t   idx;
+    const Ending *e = solvedEnding(p, idx);
+    if (!e) {
+        std::cout << "no solved ending for " << materialName(p, false)
+                  << std::endl;
+        std::exit(1);
+    }
+    return e->wdl[idx];
+}
+
+// Wins, losses and draws first, by counting down the moves of each
+// position to won children from the positions already decided. Then the
+// dtz, the plies to a capture, pawn move or mate the way the tables count
+// them: 1 for a winning zeroing move or a mate, else one more than the
+// quickest loss for a win, and than the slowest win for a loss.
+static void solve(Ending &e) {
+    std::size_t size = e.size();
+    e.wdl.assign(size, UNKNOWN);
+    e.dtz.assign(size, 0);
+    e.mated.assign(size, false);
+
+    std::vector<ui8>         moves_left(size, 0);
+    std::vector<bool>        escapes(size, false); // to a drawn ending
+    std::vector<std::size_t> decided;
+
+    for (std::size_t idx = 0; idx < size; idx++) {
+        Placement p = placementAt(e, idx);
+        if (!legal(p)) {
+            e.wdl[idx] = ILLEGAL;
+            continue;
+        }
+
+        int  internal = 0;
+        bool any = false, wins = false, escape = false;
+        forEachMove(p, [&](const Placement &child, bool, bool same) {
+            any = true;
+            if (same) {
+                internal++;
+            } else {
+                i8 value = solvedWdl(child);
+                wins |= value < 0;
+                escape |= value == 0;
+            }
+        });
+
+        if (!any) {
+            Color them   = Color(p.turn ^ 1);
+            bool  check  = attacked(p, kingSquare(p, p.turn), them);
+            e.wdl[idx]   = check ? -2 : 0;
+            e.mated[idx] = check;
+        } else if (wins) {
+            e.wdl[idx] = 2;
+        } else if (!internal) {
+            e.wdl[idx] = escape ? 0 : -2;
+        } else {
+            moves_left[idx] = ui8(internal);
+            escapes[idx]    = escape;
+            continue;
+        }
+        if (e.wdl[idx]) {
+            decided.push_back(idx);
+        }
+    }
+
+    for (std::size_t k = 0; k < decided.size(); k++) {
+        i8 value = e.wdl[decided[k]];
+        forEachUnmove(placementAt(e, decided[k]),
+                      [&](const Placement &parent, bool) {
+                          std::size_t pi = indexOf(parent);
+                          if (e.wdl[pi] != UNKNOWN) {
+                              return;
+                          }
+                          if (value < 0) {
+                              e.wdl[pi] = 2;
+                              decided.push_back(pi);
+                          } else if (--moves_left[pi] == 0 && !escapes[pi]) {
+                              e.wdl[pi] = -2;
+                              decided.push_back(pi);
+                          }
+                      });
+    }
+
+    // the dtz by levels, a win takes the first it can, a loss waits for
+    // its last non-zeroing move
+    std::vector<std::vector<std::size_t>> levels(2);
+    for (std::size_t idx = 0; idx < size; idx++) {
+        if (e.wdl[idx] == UNKNOWN) {
+            e.wdl[idx] = 0;
+        }
+        if (e.wdl[idx] != 2 && e.wdl[idx] != -2) {
+            continue;
+        }
+
+        bool quick = e.mated[idx];
+        int  slow  = 0;
+        forEachMove(placementAt(e, idx),
+                    [&](const Placement &child, bool zeroing, bool same) {
+                        if (e.wdl[idx] > 0 && zeroing) {
+                            quick |= solvedWdl(child) < 0;
+                        } else if (e.wdl[idx] > 0) {
+                            quick |= e.mated[indexOf(child)];
+                        } else if (!zeroing) {
+                            slow += same;
+                        }
+                    });
+
+        moves_left[idx] = ui8(slow);
+        if (quick || (e.wdl[idx] < 0 && !slow)) {
+            e.dtz[idx] = 1;
+            levels[1].push_back(idx);
+        }
+    }
+
+    for (std::size_t level = 1; level < levels.size(); level++) {
+        levels.emplace_back();
+        for (std::size_t idx : levels[level]) {
+            i8 value = e.wdl[idx];
+            forEachUnmove(placementAt(e, idx),
+                          [&](const Placement &parent, bool pawn) {
+                              std::size_t pi = indexOf(parent);
+                              if (pawn || e.dtz[pi] || e.wdl[pi] != -value ||
+                                  (value > 0 && --moves_left[pi])) {
+                                  return;
+                              }
+                              e.dtz[pi] = ui8(level + 1);
+                              levels[level + 1].push_back(pi);
+                          });
+        }
+        if (levels[level + 1].empty()) {
+            break;
+        }
+    }
+}
+
+static Ending &addEnding(const std::string &name,
+                         std::initializer_list<std::pair<Color, PieceType>>
+                             pieces) {
+    Ending &e = endings[name];
+    e.name    = name;
+    for (const auto &[color, type] : pieces) {
+        e.pieces.colors[e.pieces.count]  = color;
+        e.pieces.types[e.pieces.count++] = type;
+    }
+    return e;
+}
+
+// in the order each needs the ones before it, the pieces in the order the
+// tables encode them: three unique pieces lead, or the pawn
+static void solveAll(bool four_pieces) {
+    const Color W = CL_WHITE, B = CL_BLACK;
+    endings.clear();
+    addEnding("KBvK", {{W, PT_KING}, {W, PT_BISHOP}, {B, PT_KING}});
+    addEnding("KNvK", {{W, PT_KING}, {W, PT_KNIGHT}, {B, PT_KING}});
+    addEnding("KQvK", {{W, PT_KING}, {W, PT_QUEEN}, {B, PT_KING}});
+    addEnding("KRvK", {{W, PT_KING}, {W, PT_ROOK}, {B, PT_KING}});
+    addEnding("KPvK", {{W, PT_PAWN}, {W, PT_KING}, {B, PT_KING}});
+    if (four_pieces) {
+        addEnding(
+            "KNvKN",
+            {{W, PT_KING}, {W, PT_KNIGHT}, {B, PT_KING}, {B, PT_KNIGHT}});
+    }
+
+    for (const char *name : {"KBvK", "KNvK", "KQvK", "KRvK", "KPvK", "KNvKN"}) {
+        auto found = endings.find(name);
+        if (found != endings.end()) {
+            solve(found->second);
+        }
+    }
+}
+
+// Writing. The tables index a position by its leading pieces mirrored into
+// a corner, and the rest by the squares left, see doProbeTable. Here the
+// index is turned back into a position, so that the two directions are
+// written apart and the probes check one against the other.
+
+static int nthFree(int n, const int taken[], int count, int step = 1) {
+    for (int s = 0;; s += step) {
+        if (std::find(taken, taken + count, s) == taken + count && !n--) {
+            return s;
+        }
+    }
+}
+
+// the three leading squares, a1 = 0, of a table without pawns at its
+// index, false for the indices of no position
+static bool leadingSquares(ui64 idx, int squares[]) {
+    static const int TRIANGLE[] = {1, 2, 3, 10, 11, 19}; // b1 c1 d1 c2 d2 d3
+    std::vector<int> below; // the squares below the a1-h8 diagonal
+    for (int s = 0; s < 64; s++) {
+        if ((s >> 3) < (s & 7)) {
+            below.push_back(s);
+        }
+    }
+
+    if (idx < 6 * 63 * 62) { // the first off the diagonal
+        squares[0] = TRIANGLE[idx / (63 * 62)];
+        squares[1] = nthFree(int(idx / 62 % 63), squares, 1);
+        squares[2] = nthFree(int(idx % 62), squares, 2);
+        return true;
+    }
+    idx -= 6 * 63 * 62;
+    if (idx < 4 * 28 * 62) { // the first on it, the second off it
+        squares[0] = 9 * int(idx / (28 * 62));
+        squares[1] = below[idx / 62 % 28];
+        squares[2] = nthFree(int(idx % 62), squares, 2);
+        return true;
+    }
+    idx -= 4 * 28 * 62;
+    if (idx < 4 * 7 * 28) { // the first two on it
+        squares[0] = 9 * int(idx / (7 * 28));
+        squares[1] = nthFree(int(idx / 28 % 7), squares, 1, 9);
+        squares[2] = below[idx % 28];
+        return true;
+    }
+    idx -= 4 * 7 * 28;
+    if (idx < 4 * 7 * 6) { // all three on it
+        squares[0] = 9 * int(idx / 42);
+        squares[1] = nthFree(int(idx / 6 % 7), squares, 1, 9);
+        squares[2] = nthFree(int(idx % 6), squares, 2, 9);
+        return true;
+    }
+    return false;
+}
+
+static ui64 tableSize(const Ending &e) {
+    bool pawns = e.pieces.types[0] == PT_PAWN;
+    ui64 size  = pawns ? 6 : 31332;
+    for (int k = pawns ? 1 : 3; k < e.pieces.count; k++) {
+        size *= 64 - k;
+    }
+    return size;
+}
+
+// the position at idx of the table of the leading pawn's file, false for
+// the indices of no position
+static bool positionAt(const Ending &e, int file, ui64 idx, Placement &p) {
+    int squares[MAX_PIECES], k;
+    p = e.pieces;
+    if (e.pieces.types[0] == PT_PAWN) {
+        squares[0] = 8 * int(idx % 6 + 1) + file;
+        idx /= 6;
+        k = 1;
+    } else {
+        if (!leadingSquares(idx % 31332, squares)) {
+            return false;
+        }
+        idx /= 31332;
+        k = 3;
+    }
+    for (; k < p.count; k++) {
+        squares[k] = nthFree(int(idx % (64 - k)), squares, k);
+        idx /= 64 - k;
+    }
+
+    for (k = 0; k < p.count; k++) {
+        p.squares[k] = squares[k] ^ 56;
+    }
+    return true;
+}
+
+struct Packed { // one table of a file, compressed
+    ui8                                flags = 0;
+    ui8                                value = 0; // of a single value table
+    int                                block_log = 6, span_log = 0;
+    int                                min_len = 0, max_len = 0;
+    std::vector<ui16>                  lowest_sym; // by code length
+    std::vector<std::array<ui8, 3>>    btree;      // by symbol
+    std::vector<ui16>                  block_length;
+    std::vector<std::pair<ui32, ui16>> sparse; // block and offset
+    std::vector<ui8>                   blocks;
+};
+
+// Runs of up to 256 equal values become one symbol, a pair of the runs
+// half as long, and the symbols a canonical huffman code with the longest
+// codes the lowest, as decompressPairs reads them.
+static Packed pack(const std::vector<ui8> &values, ui8 flags) {
+    const int MAX_BLOCK_VALUES = 1 << 15;
+
+    Packed out;
+    out.flags = flags;
+    if (std::all_of(values.begin(), values.end(), [&](ui8 v) {
+            return v == values[0];
+        })) {
+        out.flags |= 128; // TB_SINGLE_VALUE
+        out.value = values[0];
+        return out;
+    }
+
+    struct Symbol {
+        int left, right; // the value of a leaf, and -1
+        int length;
+    };
+    std::vector<Symbol>                symbols;
+    std::map<std::pair<int, int>, int> runs; // by value and log2 length
+    auto run = [&](auto &self, int value, int log) -> int {
+        auto found = runs.find({value, log});
+        if (found != runs.end()) {
+            return found->second;
+        }
+        Symbol s = {value, -1, 1};
+        if (log > 0) {
+            int half = self(self, value, log - 1);
+            s        = {half, half, 2 * symbols[half].length};
+        }
+        symbols.push_back(s);
+        return runs[{value, log}] = int(symbols.size()) - 1;
+    };
+
+    std::vector<int> tokens;
+    for (std::size_t i = 0; i < values.size();) {
+        std::size_t n = 1;
+        while (n < 256 && i + n < values.size() && values[i + n] == values[i]) {
+            n++;
+        }
+        int log = std::bit_width(n) - 1;
+        tokens.push_back(run(run, values[i], log));
+        i += std::size_t(1) << log;
+    }
+
+    // huffman code lengths
+    std::vector<ui64> freq(symbols.size(), 0);
+    for (int t : tokens) {
+        freq[t]++;
+    }
+    std::vector<int> parent, length(symbols.size(), 0);
+    typedef std::pair<ui64, int> Node;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+    for (std::size_t s = 0; s < symbols.size(); s++) {
+        parent.push_back(-1);
+        if (freq[s]) {
+            heap.push({freq[s], int(s)});
+        }
+    }
+    while (heap.size() > 1) {
+        Node a = heap.top();
+        heap.pop();
+        Node b = heap.top();
+        heap.pop();
+        parent.push_back(-1);
+        parent[a.second] = parent[b.second] = int(parent.size()) - 1;
+        heap.push({a.first + b.first, int(parent.size()) - 1});
+    }
+    std::vector<int> coded;
+    for (std::size_t s = 0; s < symbols.size(); s++) {
+        for (int n = parent[s]; freq[s] && n >= 0; n = parent[n]) {
+            length[s]++;
+        }
+        if (freq[s]) {
+            coded.push_back(int(s));
+        }
+    }
+
+    // the longest codes get the lowest symbols and codes
+    std::stable_sort(coded.begin(), coded.end(), [&](int a, int b) {
+        return length[a] > length[b];
+    });
+    out.max_len = length[coded.front()];
+    out.min_len = length[coded.back()];
+    if (out.max_len > 32) {
+        std::cout << "huffman codes too long" << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<int> number(symbols.size(), -1), order;
+    for (int s : coded) {
+        number[s] = int(order.size());
+        order.push_back(s);
+    }
+    for (std::size_t s = 0; s < symbols.size(); s++) {
+        if (number[s] < 0) {
+            number[s] = int(order.size());
+            order.push_back(int(s));
+        }
+    }
+
+    std::vector<ui64> base(out.max_len + 2, 0), count(out.max_len + 2, 0);
+    for (int s : coded) {
+        count[length[s]]++;
+    }
+    out.lowest_sym.assign(out.max_len - out.min_len + 1, 0);
+    for (int len = out.max_len - 1; len >= out.min_len; len--) {
+        base[len] = (base[len + 1] + count[len + 1]) / 2;
+        out.lowest_sym[len - out.min_len] =
+            ui16(out.lowest_sym[len + 1 - out.min_len] + count[len + 1]);
+    }
+
+    for (int s : order) {
+        const Symbol &sym   = symbols[s];
+        int           left  = sym.right < 0 ? sym.left : number[sym.left];
+        int           right = sym.right < 0 ? 0xFFF : number[sym.right];
+        out.btree.push_back({ui8(left & 0xFF),
+                             ui8((left >> 8) | ((right & 0xF) << 4)),
+                             ui8(right >> 4)});
+    }
+
+    // the tokens into blocks, a new one when the next doesn't fit
+    std::size_t              block_bits = std::size_t(8) << out.block_log;
+    std::size_t              bits = block_bits, block_values = 0;
+    std::vector<std::size_t> starts;
+    std::size_t              position = 0;
+    for (int t : tokens) {
+        int len = length[t];
+        int n   = symbols[t].length;
+        if (bits + len > block_bits || block_values + n > MAX_BLOCK_VALUES) {
+            if (!starts.empty()) {
+                out.block_length.push_back(ui16(block_values - 1));
+            }
+            starts.push_back(position);
+            out.blocks.resize(out.blocks.size() + block_bits / 8, 0);
+            bits = block_values = 0;
+        }
+
+        ui64 code = base[len] + (number[t] - out.lowest_sym[len - out.min_len]);
+        for (int b = len - 1; b >= 0; b--, bits++) {
+            if (code >> b & 1) {
+                std::size_t at = out.blocks.size() - block_bits / 8 + bits / 8;
+                out.blocks[at] |= ui8(0x80 >> (bits % 8));
+            }
+        }
+        block_values += n;
+        position += n;
+    }
+    out.block_length.push_back(ui16(block_values - 1));
+
+    // an entry for every span values, pointing at the middle of them
+    while ((std::size_t(1) << out.span_log) * starts.size() < values.size() &&
+           out.span_log < 15) {
+        out.span_log++;
+    }
+    std::size_t span = std::size_t(1) << out.span_log;
+    for (std::size_t k = 0; k * span < values.size(); k++) {
+        std::size_t middle = k * span + span / 2;
+        std::size_t block =
+            std::upper_bound(starts.begin(), starts.end(), middle) -
+            starts.begin() - 1;
+        out.sparse.push_back({ui32(block), ui16(middle - starts[block])});
+    }
+    return out;
+}
+
+static int tbPiece(Color color, PieceType type) {
+    return (type + 1) | (color == CL_BLACK ? 8 : 0);
+}
+
+static bool writeFile(const std::string                      &path,
+                      const Ending                           &e,
+                      bool                                    dtz,
+                      const std::vector<std::vector<Packed>> &tables) {
+    static const ui8 MAGICS[2][4] = {{0x71, 0xE8, 0x23, 0x5D},
+                                     {0xD7, 0x66, 0x0C, 0xA5}};
+
+    std::vector<ui8> out(MAGICS[dtz], MAGICS[dtz] + 4);
+    auto             put = [&out](ui64 value, int bytes) {
+        for (int b = 0; b < bytes; b++) {
+            out.push_back(ui8(value >> (8 * b)));
+        }
+    };
+    auto align = [&out](std::size_t to) {
+        while (out.size() % to) {
+            out.push_back(0);
+        }
+    };
+
+    bool pawns = e.pieces.types[0] == PT_PAWN;
+    bool split = e.name.substr(0, e.name.find('v')) !=
+                 e.name.substr(e.name.find('v') + 1);
+    put(split | (pawns << 1), 1);
+    for (std::size_t f = 0; f < tables.size(); f++) {
+        put(0, 1); // the leading group's index first, for both sides
+        for (int k = 0; k < e.pieces.count; k++) {
+            int piece = tbPiece(e.pieces.colors[k], e.pieces.types[k]);
+            put(piece | piece << 4, 1);
+        }
+    }
+    align(2);
+
+    for (const auto &sides : tables) {
+        for (const Packed &t : sides) {
+            put(t.flags, 1);
+            if (t.flags & 128) {
+                put(t.value, 1);
+                continue;
+            }
+            put(t.block_log, 1);
+            put(t.span_log, 1);
+            put(0, 1); // no block_length padding
+            put(t.block_length.size(), 4);
+            put(t.max_len, 1);
+            put(t.min_len, 1);
+            for (ui16 sym : t.lowest_sym) {
+                put(sym, 2);
+            }
+            put(t.btree.size(), 2);
+            for (const auto &lr : t.btree) {
+                out.insert(out.end(), lr.begin(), lr.end());
+            }
+            if (t.btree.size() & 1) {
+                put(0, 1);
+            }
+        }
+    }
+    if (dtz) {
+        align(2); // no value maps
+    }
+
+    for (const auto &sides : tables) {
+        for (const Packed &t : sides) {
+            for (const auto &[block, offset] : t.sparse) {
+                put(block, 4);
+                put(offset, 2);
+            }
+        }
+    }
+    for (const auto &sides : tables) {
+        for (const Packed &t : sides) {
+            for (ui16 length : t.block_length) {
+                put(length, 2);
+            }
+        }
+    }
+    for (const auto &sides : tables) {
+        for (const Packed &t : sides) {
+            align(64);
+            out.insert(out.end(), t.blocks.begin(), t.blocks.end());
+        }
+    }
+
+    // room for the decoder to read past the last block, and the size the
+    // files have
+    out.resize(out.size() + 16);
+    while (out.size() % 64 != 16) {
+        out.push_back(0);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()),
+               std::streamsize(out.size()));
+    std::cout << path << " " << out.size() << " bytes" << std::endl;
+    return bool(file);
+}
+
+// the WDL tables of both sides to move, white's only when both have the
+// same pieces, and the DTZ table of white to move, what isn't a position
+// or has no dtz repeating the value before it to compress
+static bool generate(const std::string &dir, const Ending &e) {
+    bool pawns     = e.pieces.types[0] == PT_PAWN;
+    bool symmetric = e.name == "KNvKN";
+
+    std::vector<std::vector<Packed>> wdl_tables, dtz_tables;
+    for (int f = 0; f <= (pawns ? 3 : 0); f++) {
+        wdl_tables.emplace_back();
+        dtz_tables.emplace_back();
+        for (int side = 0; side < (symmetric ? 1 : 2); side++) {
+            std::vector<ui8> wdl, dtz;
+            ui8              last_wdl = 2, last_dtz = 0;
+            for (ui64 idx = 0; idx < tableSize(e); idx++) {
+                Placement p;
+                if (positionAt(e, f, idx, p)) {
+                    p.turn         = Color(side);
+                    std::size_t at = indexOf(p);
+                    if (legal(p)) {
+                        last_wdl = ui8(e.wdl[at] + 2);
+                    }
+                    if (legal(p) && e.wdl[at]) {
+                        last_dtz = ui8(e.dtz[at] - 1);
+                    }
+                }
+                wdl.push_back(last_wdl);
+                dtz.push_back(last_dtz);
+            }
+            wdl_tables.back().push_back(pack(wdl, 0));
+            if (side == 0) {
+                dtz_tables.back().push_back(pack(dtz, 4 | 8)); // in plies
+            }
+        }
+    }
+
+    return writeFile(dir + "/" + e.name + ".rtbw", e, false, wdl_tables) &&
+           writeFile(dir + "/" + e.name + ".rtbz", e, true, dtz_tables);
+}
+
+// Checking.
+
+static std::string fenOf(const Placement &p) {
+    const std::string PIECES = "pnbrqk";
+
+    char board[64];
+    std::fill(board, board + 64, ' ');
+    for (int i = 0; i < p.count; i++) {
+        char piece = PIECES[p.types[i]];
+        board[p.squares[i]] =
+            p.colors[i] == CL_WHITE ? char(std::toupper(piece)) : piece;
+    }
+
+    std::string fen;
+    for (int row = 0; row < 8; row++) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            char c = board[8 * row + col];
+            if (c == ' ') {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                fen += char('0' + empty);
+            }
+            fen += c;
+            empty = 0;
+        }
+        if (empty) {
+            fen += char('0' + empty);
+        }
+        fen += row < 7 ? "/" : "";
+    }
+    return fen + (p.turn == CL_WHITE ? " w" : " b") + " - - 0 1";
+}
+
+static std::string render(const Move &move) {
+    std::string out;
+    for (Square sq : {move.from(), move.to()}) {
+        out += char('a' + (sq & 7));
+        out += char('8' - (sq >> 3));
+    }
+    if (move.isPromotion()) {
+        out += "pnbrqk"[move.promotion()];
+    }
+    return out;
+}
+
+struct Checker {
+    ui64 checked  = 0;
+    ui64 failures = 0;
+
+    void expect(bool ok, const std::string &what) {
+        this->checked++;
+        if (!ok && this->failures++ < 10) {
+            std::cout << "FAIL " << what << std::endl;
+        }
+    }
+
+    void probe(const std::string &fen, int wdl, int dtz, bool with_dtz) {
+        Position   pos = Position::fromFen(fen);
+        ProbeState result;
+        int        probed = Tablebases::probeWDL(pos, result);
+        this->expect(result != PROBE_FAIL && probed == wdl,
+                     fen + " wdl " + std::to_string(probed) + " not " +
+                         std::to_string(wdl));
+        if (with_dtz) {
+            probed = Tablebases::probeDTZ(pos, result);
+            this->expect(result != PROBE_FAIL && probed == dtz,
+                         fen + " dtz " + std::to_string(probed) + " not " +
+                             std::to_string(dtz));
+        }
+    }
+
+    // the game from fen, the moves played one after the other
+    static std::vector<Position> game(const std::string              &fen,
+                                      const std::vector<std::string> &moves) {
+        std::vector<Position> hist = {Position::fromFen(fen)};
+        for (const std::string &uci : moves) {
+            Position pos = hist.back();
+            Status   status;
+            for (const Move &move : pos.genMoves()) {
+                if (render(move) == uci) {
+                    pos.makeMove(move, status);
+                    break;
+                }
+            }
+            hist.push_back(pos);
+        }
+        return hist;
+    }
+
+    // the moves ranked best at the end of the game are those of expected,
+    // or all the legal moves when it is empty, scored as the search would
+    void rank(const std::vector<Position>    &hist,
+              const std::vector<std::string> &expected,
+              int                             score) {
+        MoveList    moves, legal = hist.back().genMoves();
+        bool        by_dtz = false;
+        ui64        probes = 0;
+        bool ok = Tablebases::rankRootMoves(hist, 4, moves, by_dtz, probes);
+
+        std::vector<std::string> ranked, wanted = expected;
+        for (const Move &move : moves) {
+            ranked.push_back(render(move));
+        }
+        if (wanted.empty()) {
+            for (const Move &move : legal) {
+                wanted.push_back(render(move));
+            }
+        }
+        std::sort(ranked.begin(), ranked.end());
+        std::sort(wanted.begin(), wanted.end());
+
+        std::string line;
+        for (const std::string &move : ranked) {
+            line += " " + move;
+        }
+        ok = ok && by_dtz && ranked == wanted;
+        this->expect(ok, "ranked" + line + " after " +
+                             std::to_string(hist.size() - 1) + " moves");
+        this->expect(ok && Tablebases::rootScore(moves.score(0), true) ==
+                               score,
+                     "root score " + std::to_string(score));
+        this->expect(probes > 0 && probes <= ui64(legal.size()),
+                     std::to_string(probes) + " root probes");
+    }
+};
+
+// every position of the three piece endings, solved again, and with the
+// colours swapped, the dtz of every dtz_step-th
+static void checkSolved(Checker &checker, int dtz_step) {
+    for (const auto &[name, e] : endings) {
+        for (std::size_t idx = 0; idx < e.size(); idx++) {
+            Placement p = placementAt(e, idx);
+            if (!legal(p)) {
+                continue;
+            }
+
+            int wdl = e.wdl[idx];
+            int dtz = wdl > 0 ? e.dtz[idx] : wdl < 0 ? -e.dtz[idx] : 0;
+            checker.probe(fenOf(p), wdl, dtz, idx % dtz_step == 0);
+
+            for (int i = 0; i < p.count; i++) {
+                p.colors[i] = Color(p.colors[i] ^ 1);
+                p.squares[i] ^= 56;
+            }
+            p.turn = Color(p.turn ^ 1);
+            checker.probe(fenOf(p), wdl, dtz, idx % dtz_step == 1);
+        }
+    }
+}
+
+static bool check(const std::string &dir) {
+    Tablebases::init(dir);
+    if (Tablebases::max_cardinality < 4) {
+        std::cout << "no tables in " << dir << std::endl;
+        return false;
+    }
+
+    Checker checker;
+    solveAll(false);
+    checkSolved(checker, 16);
+
+    // KNvKN, mates on the board, ones to play, and a draw
+    checker.probe("6nk/5N2/6K1/8/8/8/8/8 b - - 0 1", -2, -1, true);
+    checker.probe("7k/5K1n/6N1/8/8/8/8/8 b - - 0 1", -2, -1, true);
+    checker.probe("8/8/8/8/8/6k1/5n2/6NK w - - 0 1", -2, -1, true);
+    checker.probe("6nk/8/6K1/6N1/8/8/8/8 w - - 0 1", 2, 1, true);
+    checker.probe("7k/5K1n/8/4N3/8/8/8/8 w - - 0 1", 2, 1, true);
+    checker.probe("8/8/8/8/6n1/6k1/8/6NK b - - 0 1", 2, 1, true);
+    checker.probe("8/8/3k4/8/2n5/8/3N4/3K4 w - - 0 1", 0, 0, true);
+    checker.probe("8/8/3k4/8/2n5/8/3N4/3K4 b - - 0 1", 0, 0, true);
+
+    // the winning moves of KPvK, where the pawn can only win by waiting
+    const char *fen = "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1";
+    Position    pos = Position::fromFen(fen);
+    std::vector<std::string> wins;
+    for (const Move &move : pos.genMoves()) {
+        Position child = pos;
+        Status   status;
+        child.makeMove(move, status);
+        ProbeState result;
+        if (Tablebases::probeWDL(child, result) == WDL_LOSS) {
+            wins.push_back(render(move));
+        }
+    }
+    checker.rank({pos}, wins, TB_WIN);
+
+    // KQvK, where the king can't escape but to a third repetition
+    const char *start = "8/8/8/4k3/8/8/8/KQ6 w - - 0 1";
+    checker.rank(Checker::game(start, {"a1a2", "e5e6", "a2a1"}), {}, -TB_WIN);
+    checker.rank(
+        Checker::game(start, {"a1a2", "e5e6", "a2a1", "e6e5", "a1a2", "e5e6",
+                              "a2a1"}),
+        {"e6e5"},
+        0);
+
+    std::cout << (checker.failures ? "FAIL " : "ok   ") << checker.checked
+              << " probes, " << checker.failures << " failures" << std::endl;
+    return !checker.failures;
+}
+
+int main(int argc, char *argv[]) {
+    std::string command = argc > 1 ? argv[1] : "";
+    if (argc < 3 || (command != "gen" && command != "check")) {
+        std::cout << "usage: kingfish_tb gen <dir>\n"
+                     "       kingfish_tb check <dir>"
+                  << std::endl;
+        return 1;
+    }
+
+    BBS::initLeaperAttacks();
+    BBS::initSliderAttacks();
+    BBS::initLines();
+
+    if (command == "gen") {
+        solveAll(true);
+        for (const auto &[name, e] : endings) {
+            if (!generate(argv[2], e)) {
+                std::cout << "could not write " << name << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    return check(argv[2]) ? 0 : 1;
+}